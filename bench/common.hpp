@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "../ezcl.hpp"
+
+// helpers shared by the benchmarks and the tests
+
+struct PickedDevice {
+    ezcl::PlatformId platform;
+    ezcl::DeviceId device;
+};
+
+// the device with the most reported compute units
+inline PickedDevice pickDevice() {
+    std::vector<ezcl::PlatformId> plats = ezcl::getPlatforms();
+    size_t maxCompUnits = 0;
+    size_t platIndex = 0;
+    size_t devIndex = 0;
+
+    for (size_t i = 0; i < plats.size(); i++) {
+        const std::vector<ezcl::DeviceId>& devices = plats[i].getDevices();
+
+        for (size_t j = 0; j < devices.size(); j++) {
+            if (devices[j].computeUnits() > maxCompUnits) {
+                maxCompUnits = devices[j].computeUnits();
+                platIndex = i;
+                devIndex = j;
+            }
+        }
+    }
+
+    return {plats[platIndex], plats[platIndex].getDevices()[devIndex]};
+}
+
+// a device without doubles reports a preferred vector width of 0 for them
+inline bool supported(const ezcl::DeviceId& device, ezcl::NumType type) {
+    cl_uint preferred = 0;
+    clGetDeviceInfo(device.id(), ezcl::numInfo[type].vectorWidthInfo, sizeof(preferred), &preferred, nullptr);
+    return preferred != 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+
+#include "common.hpp"
+
+// measures the host cost of dispatching cached kernels and counts the heap allocations each dispatch makes,
+// exits with 1 if any of them allocates,
+// usage: dispatch [calls per operation, default 1000000] [elements per Array, default 1024]
+//
+// only operator new is counted, allocations inside the OpenCL implementation aren't,
+// this uses a single queue with profiling and tracing off, as several queues track events per Array
+
+std::atomic<size_t> allocations(0);
+
+// gcc can't tell that these replace the global operators once it inlines them
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+void operator delete(void* ptr) noexcept {std::free(ptr);}
+void operator delete[](void* ptr) noexcept {std::free(ptr);}
+void operator delete(void* ptr, size_t) noexcept {operator delete(ptr);}
+void operator delete[](void* ptr, size_t) noexcept {operator delete(ptr);}
+
+bool allocationFree = true;
+
+// f is called once beforehand to build the kernel, then calls times, finishing every 1024 calls
+template <typename F>
+void measure(ezcl::Device& dev, const char* name, size_t calls, F f) {
+    f();
+    dev.finish();
+
+    const size_t before = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++) {
+        f();
+        if (i % 1024 == 1023) dev.finish();
+    }
+    dev.finish();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const size_t allocated = allocations.load() - before;
+
+    if (allocated) allocationFree = false;
+
+    std::cout
+        << std::left << std::setw(24) << name
+        << std::right << std::setw(14) << std::fixed << std::setprecision(1) << elapsed.count() / calls * 1e9
+        << std::setw(16) << std::setprecision(3) << static_cast<double>(allocated) / calls << '\n'
+    ;
+}
+
+int main(int argc, char** argv) {
+    const size_t calls = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t s = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 1024;
+
+    const auto [platform, device] = pickDevice();
+    ezcl::Device dev(platform, device);
+
+    ezcl::Array<float> a(dev, ezcl::READ_ONLY, s, 1.0f);
+    ezcl::Array<float> b(dev, ezcl::READ_ONLY, s, 2.0f);
+    ezcl::Array<float> c(dev, ezcl::READ_WRITE, s);
+
+    std::cout << "Device: " << device.name() << " (" << device.typeString() << "), " << s << " elements, " << calls << " calls each\n\n";
+    std::cout << std::left << std::setw(24) << "dispatch" << std::right << std::setw(14) << "ns/call" << std::setw(16) << "allocs/call" << '\n';
+
+    measure(dev, "add(a, b, c)", calls, [&]{dev.add(a, b, c);});
+    measure(dev, "apply<MUL>(a, b, c)", calls, [&]{dev.apply<ezcl::MUL>(a, b, c);});
+    measure(dev, "add(a, 2, c)", calls, [&]{dev.add(a, 2.0f, c);});
+    measure(dev, "sub(2, a, c)", calls, [&]{dev.sub(2.0f, a, c);});
+    measure(dev, "addAsync(a, b, c)", calls, [&]{dev.addAsync(a, b, c);});
+    measure(dev, "eval(c, (a + b) * a)", calls, [&]{dev.eval(c, (a + b) * a);});
+
+    std::cout << '\n' << (allocationFree ? "no dispatch allocated" : "some dispatches allocated") << '\n';
+    return allocationFree ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#include "common.hpp"
+
+// runs every elementwise op on every type at sizes from 1K to 1G elements, and the Array transfers,
+// prints a table and writes the results as JSON for tracking them over time,
+// usage: suite [smallest size, default 1024] [largest size, default 1073741824] [seconds per measurement, default 0.2] [JSON file, default suite.json]
+//
+// sizes go up by a factor of 4, sizes that don't fit in half of the device's memory are skipped,
+// so are types the device doesn't support, and if a type fails the results so far are still written
+
+struct Result {
+    std::string kind; // "op", "compile" or "transfer"
+    std::string name;
+    std::string type;
+    size_t elements;
+    size_t bytes;     // bytes moved per call
+    double seconds;   // per call
+    double firstCall; // seconds, compile results only
+};
+
+std::vector<Result> results;
+
+double since(std::chrono::steady_clock::time_point start) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// calls f in growing batches until minSeconds have passed, returns the seconds per call
+template <typename F>
+double timeCalls(ezcl::Device& dev, F f, double minSeconds) {
+    size_t calls = 0;
+    size_t batch = 1;
+    const auto start = std::chrono::steady_clock::now();
+
+    while (true) {
+        for (size_t i = 0; i < batch; i++) f();
+        dev.finish();
+        calls += batch;
+
+        const double elapsed = since(start);
+        if (elapsed >= minSeconds) return elapsed / calls;
+        batch = calls;
+    }
+}
+
+void printResult(const Result& r) {
+    std::cout
+        << std::left << std::setw(10) << r.kind << std::setw(8) << r.name << std::setw(10) << r.type
+        << std::right << std::setw(12) << r.elements
+        << std::setw(14) << std::fixed << std::setprecision(3) << r.seconds * 1e6
+    ;
+    if (r.kind == "compile") {
+        std::cout << std::setw(12) << std::setprecision(2) << r.firstCall * 1e3 << " ms first call";
+    } else {
+        std::cout
+            << std::setw(12) << std::setprecision(2) << r.bytes / r.seconds / 1e9
+            << std::setw(14) << std::setprecision(3) << r.elements / r.seconds / 1e9
+        ;
+    }
+    std::cout << '\n';
+}
+
+void record(const Result& r) {
+    results.push_back(r);
+    printResult(r);
+}
+
+bool fits(const ezcl::DeviceId& device, size_t bytes) {
+    return bytes <= device.memSize() / 2;
+}
+
+template <ezcl::OpType Op, typename T>
+void benchOp(ezcl::Device& dev, const ezcl::DeviceId& device, size_t minSize, size_t maxSize, double minSeconds) {
+    const char* opName = ezcl::opInfo[Op].name;
+    const char* typeName = ezcl::numInfo[ezcl::NumTypeOf<T>::value].className;
+
+    // the first call builds the kernel, each later call is one launch plus the wait for it
+    {
+        ezcl::Array<T> a(dev, ezcl::READ_ONLY, minSize, T(3));
+        ezcl::Array<T> b(dev, ezcl::READ_ONLY, minSize, T(1));
+        ezcl::Array<T> c(dev, ezcl::WRITE_ONLY, minSize);
+        dev.finish();
+
+        const auto start = std::chrono::steady_clock::now();
+        dev.apply<Op>(a, b, c);
+        dev.finish();
+        const double firstCall = since(start);
+
+        const double cached = timeCalls(dev, [&]{dev.apply<Op>(a, b, c); dev.finish();}, minSeconds);
+        record({"compile", opName, typeName, minSize, 3 * sizeof(T) * minSize, cached, firstCall});
+    }
+
+    for (size_t s = minSize; s <= maxSize; s *= 4) {
+        const size_t bytes = 3 * sizeof(T) * s; // two reads and one write per element
+        if (!fits(device, bytes)) break;
+
+        ezcl::Array<T> a(dev, ezcl::READ_ONLY, s, T(3));
+        ezcl::Array<T> b(dev, ezcl::READ_ONLY, s, T(1));
+        ezcl::Array<T> c(dev, ezcl::WRITE_ONLY, s);
+        dev.apply<Op>(a, b, c);
+
+        record({"op", opName, typeName, s, bytes, timeCalls(dev, [&]{dev.apply<Op>(a, b, c);}, minSeconds), 0});
+    }
+}
+
+// every op in opInfo, so ops added to objects.cjs are picked up
+template <typename T, size_t... Ops>
+void benchType(ezcl::Device& dev, const ezcl::DeviceId& device, size_t minSize, size_t maxSize, double minSeconds, std::index_sequence<Ops...>) {
+    (benchOp<static_cast<ezcl::OpType>(Ops), T>(dev, device, minSize, maxSize, minSeconds), ...);
+}
+
+bool failed = false;
+
+template <typename T>
+void benchType(ezcl::Device& dev, const ezcl::DeviceId& device, size_t minSize, size_t maxSize, double minSeconds) {
+    const ezcl::NumType type = ezcl::NumTypeOf<T>::value;
+    if (!supported(device, type)) {
+        std::cout << "skipping " << ezcl::numInfo[type].className << ", the device doesn't support it\n";
+        return;
+    }
+
+    try {
+        benchType<T>(dev, device, minSize, maxSize, minSeconds, std::make_index_sequence<std::size(ezcl::opInfo)>());
+    } catch (const std::exception& e) {
+        failed = true;
+        std::cout << "skipping the rest of " << ezcl::numInfo[type].className << ": " << e.what() << '\n';
+        dev.finish();
+    }
+}
+
+void benchTransfers(ezcl::Device& dev, const ezcl::DeviceId& device, size_t minSize, size_t maxSize, double minSeconds) {
+    for (size_t s = minSize; s <= maxSize; s *= 4) {
+        const size_t bytes = sizeof(float) * s;
+        if (!fits(device, bytes)) break;
+
+        std::vector<float> host(s, 1.0f);
+        ezcl::Array<float> a(dev, ezcl::READ_WRITE, s);
+
+        record({"transfer", "write", "float32", s, bytes, timeCalls(dev, [&]{a.write(host);}, minSeconds), 0});
+        record({"transfer", "read", "float32", s, bytes, timeCalls(dev, [&]{a.read(host);}, minSeconds), 0});
+        record({"transfer", "map", "float32", s, bytes, timeCalls(dev, [&]{a.map(CL_MAP_READ).unmap();}, minSeconds), 0});
+    }
+}
+
+std::string escape(const std::string& str) {
+    std::string out;
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        if (static_cast<unsigned char>(ch) >= 0x20) out += ch;
+    }
+    return out;
+}
+
+void writeJson(const std::string& path, const ezcl::PlatformId& platform, const ezcl::DeviceId& device) {
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error("cannot open " + path);
+
+    file
+        << "{\n  \"platform\": \"" << escape(platform.name()) << "\",\n  \"device\": \"" << escape(device.name())
+        << "\",\n  \"driver\": \"" << escape(device.driverVersion()) << "\",\n  \"results\": ["
+    ;
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::ostringstream line;
+        line
+            << std::setprecision(6) << "{\"kind\": \"" << r.kind << "\", \"name\": \"" << r.name << "\", \"type\": \"" << r.type
+            << "\", \"elements\": " << r.elements << ", \"bytes\": " << r.bytes << ", \"us_per_call\": " << r.seconds * 1e6
+        ;
+        if (r.kind == "compile") line << ", \"first_call_ms\": " << r.firstCall * 1e3;
+        else line << ", \"gb_per_s\": " << r.bytes / r.seconds / 1e9 << ", \"gelements_per_s\": " << r.elements / r.seconds / 1e9;
+        line << "}";
+
+        file << (i ? ",\n    " : "\n    ") << line.str();
+    }
+
+    file << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    const size_t minSize = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    const size_t maxSize = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 1073741824;
+    const double minSeconds = (argc > 3) ? std::strtod(argv[3], nullptr) : 0.2;
+    const std::string jsonPath = (argc > 4) ? argv[4] : "suite.json";
+
+    if (minSize == 0 || maxSize < minSize) {
+        std::cerr << "the smallest size must be at least 1 and at most the largest size\n";
+        return 1;
+    }
+
+    const auto [platform, device] = pickDevice();
+    ezcl::Device dev(platform, device);
+
+    // first calls should measure the OpenCL compiler, not binaries cached by an earlier run
+    #ifndef EZCL_NO_BINARY_CACHE
+        dev.setBinaryCacheDir("");
+    #endif
+
+    std::cout << "Device: " << device.name() << " (" << device.typeString() << "), sizes " << minSize << " to " << maxSize << '\n';
+    std::cout << "compile rows show the latency of one cached call, op and transfer rows the time per call when calls are queued back to back\n\n";
+    std::cout
+        << std::left << std::setw(10) << "kind" << std::setw(8) << "name" << std::setw(10) << "type"
+        << std::right << std::setw(12) << "elements" << std::setw(14) << "us/call" << std::setw(12) << "GB/s" << std::setw(14) << "Gelements/s" << '\n'
+    ;
+
+    benchType<char>(dev, device, minSize, maxSize, minSeconds);
+    benchType<short>(dev, device, minSize, maxSize, minSeconds);
+    benchType<int>(dev, device, minSize, maxSize, minSeconds);
+    benchType<long long int>(dev, device, minSize, maxSize, minSeconds);
+    benchType<unsigned char>(dev, device, minSize, maxSize, minSeconds);
+    benchType<unsigned short>(dev, device, minSize, maxSize, minSeconds);
+    benchType<unsigned int>(dev, device, minSize, maxSize, minSeconds);
+    benchType<unsigned long long int>(dev, device, minSize, maxSize, minSeconds);
+    benchType<float>(dev, device, minSize, maxSize, minSeconds);
+    benchType<double>(dev, device, minSize, maxSize, minSeconds);
+    try {
+        benchTransfers(dev, device, minSize, maxSize, minSeconds);
+    } catch (const std::exception& e) {
+        failed = true;
+        std::cout << "skipping the rest of the transfers: " << e.what() << '\n';
+    }
+
+    writeJson(jsonPath, platform, device);
+    std::cout << "\nwrote " << results.size() << " results to " << jsonPath << '\n';
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+
+#include "common.hpp"
+
+// measures the throughput of add for every type the device supports at every vector width,
+// usage: widths [elements per Array, default 16777216] [iterations, default 20]
+
+template <typename T>
+void benchType(ezcl::Device& dev, const ezcl::DeviceId& device, ezcl::NumType type, size_t s, size_t iterations) {
+    if (!supported(device, type)) {
+        std::cout << "skipping " << ezcl::numInfo[type].className << ", the device doesn't support it\n";
+        return;
+    }
+
+    const cl_uint preferred = dev.getVectorWidth(type);
+
+    std::vector<T> host(s, T(1));
+    ezcl::Array<T> a(dev, ezcl::READ_ONLY, host);
+    ezcl::Array<T> b(dev, ezcl::READ_ONLY, host);
+    ezcl::Array<T> c(dev, ezcl::WRITE_ONLY, host);
+
+    for (cl_uint width = 1; width <= 16; width *= 2) {
+        dev.setVectorWidth(type, width);
+
+        // the first call builds the kernel
+        dev.add(a, b, c);
+        dev.finish();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) dev.add(a, b, c);
+        dev.finish();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double seconds = elapsed.count() / iterations;
+        const double gigabytes = 3.0 * sizeof(T) * s / 1e9; // two reads and one write per element
+
+        std::cout
+            << std::left << std::setw(10) << ezcl::numInfo[type].className
+            << std::right << std::setw(6) << width
+            << std::setw(12) << std::fixed << std::setprecision(3) << seconds * 1e3
+            << std::setw(12) << std::setprecision(2) << gigabytes / seconds
+            << std::setw(14) << s / seconds / 1e9
+            << (width == preferred ? "   (preferred)" : "") << '\n'
+        ;
+    }
+
+    dev.setVectorWidth(type, preferred);
+}
+
+int main(int argc, char** argv) {
+    const size_t s = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 16777216;
+    const size_t iterations = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 20;
+
+    const auto [platform, device] = pickDevice();
+    ezcl::Device dev(platform, device);
+
+    std::cout << "Device: " << device.name() << " (" << device.typeString() << "), " << s << " elements, " << iterations << " iterations\n\n";
+    std::cout << std::left << std::setw(10) << "type" << std::right << std::setw(6) << "width" << std::setw(12) << "ms/call" << std::setw(12) << "GB/s" << std::setw(14) << "Gelements/s" << '\n';
+
+    benchType<char>(dev, device, ezcl::INT8, s, iterations);
+    benchType<short>(dev, device, ezcl::INT16, s, iterations);
+    benchType<int>(dev, device, ezcl::INT32, s, iterations);
+    benchType<long long int>(dev, device, ezcl::INT64, s, iterations);
+    benchType<unsigned char>(dev, device, ezcl::UINT8, s, iterations);
+    benchType<unsigned short>(dev, device, ezcl::UINT16, s, iterations);
+    benchType<unsigned int>(dev, device, ezcl::UINT32, s, iterations);
+    benchType<unsigned long long int>(dev, device, ezcl::UINT64, s, iterations);
+    benchType<float>(dev, device, ezcl::FLOAT32, s, iterations);
+    benchType<double>(dev, device, ezcl::FLOAT64, s, iterations);
+
+    return 0;
+}
@@ -61,7 +61,9 @@ int main() {
     // load vectors into the device
     ezcl::Array clA(dev, ezcl::READ_ONLY, a);
     ezcl::Array clB(dev, ezcl::READ_ONLY, b);
-    ezcl::Array clC(dev, ezcl::WRITE_ONLY, c);
+
+    // the result only needs to be allocated on the device, not uploaded
+    ezcl::Array<type> clC(dev, ezcl::WRITE_ONLY, s);
 
     // perform the operation
     dev.add(clA, clB, clC);
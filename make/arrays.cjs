@@ -19,7 +19,48 @@ const opType = [
     "DIV"
 ];
 
+const mathType = [
+    "SQRT",
+    "RSQRT",
+    "EXP",
+    "LOG",
+    "ABS",
+    "SIN",
+    "COS",
+    "TANH",
+    "POW",
+    "MINIMUM",
+    "MAXIMUM",
+    "FMA",
+    "CLAMP",
+    "AND",
+    "OR",
+    "XOR",
+    "NOT",
+    "SHL",
+    "SHR"
+];
+
+const compareType = [
+    "LESS",
+    "LESS_EQUAL",
+    "GREATER",
+    "GREATER_EQUAL",
+    "EQUAL",
+    "NOT_EQUAL"
+];
+
+const reduceType = [
+    "SUM",
+    "MIN",
+    "MAX",
+    "DOT"
+];
+
 module.exports = {
     numType,
     opType,
+    mathType,
+    compareType,
+    reduceType,
 }
\ No newline at end of file
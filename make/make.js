@@ -4,9 +4,15 @@ const objects = require("./objects.cjs");
 
 global.numType = arrays.numType;
 global.opType = arrays.opType;
+global.mathType = arrays.mathType;
+global.compareType = arrays.compareType;
+global.reduceType = arrays.reduceType;
 
 global.numMeta = objects.numMeta;
 global.opMeta = objects.opMeta;
+global.mathMeta = objects.mathMeta;
+global.compareMeta = objects.compareMeta;
+global.reduceMeta = objects.reduceMeta;
 
 function make(sourcePath) {
     let source = "";
@@ -20,20 +26,223 @@ function make(sourcePath) {
 #include <array>
 #include <string>
 #include <sstream>
+#include <iomanip>
 #include <stdexcept>
+#include <exception>
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <fstream>
+#include <iterator>
+#include <cstdlib>
+#include <cstdint>
+#include <filesystem>
+#include <chrono>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <algorithm>
+
+#if __has_include(<span>)
+    #include <span>
+#endif
 
 namespace ezcl {
-    inline std::string makeKernelFunction(const char* name, const char* typeName, const char opOperator) {
+    // elementwise kernels are grid-stride loops, so any number of work-items covers any size,
+    // with a width above 1 they step over whole vectors using vload/vstore, then over the elements left at the end
+    inline void writeElementwiseLoops(std::ostringstream& function, const cl_uint width, const std::string& vectorExpr, const std::string& scalarExpr) {
+        if (width > 1) {
+            function
+                << "\\n    const size_t n = s / " << width << ";"
+                << "\\n    for (size_t i = get_global_id(0); i < n; i += get_global_size(0)) vstore" << width << "(" << vectorExpr << ", i, c);"
+                << "\\n    for (size_t i = n * " << width << " + get_global_id(0); i < s; i += get_global_size(0)) c[i] = " << scalarExpr << ";"
+            ;
+        } else {
+            function << "\\n    for (size_t i = get_global_id(0); i < s; i += get_global_size(0)) c[i] = " << scalarExpr << ";";
+        }
+    }
+
+    inline std::string makeKernelFunction(const char* name, const char* typeName, const char opOperator, const cl_uint width = 1) {
+        std::ostringstream function;
+
+        function << "__kernel void " << name << "(__global const " << typeName << "* a, __global const " << typeName << "* b, __global " << typeName << "* c, const ulong s) {";
+
+        const std::string load = "vload" + std::to_string(width);
+        writeElementwiseLoops(function, width, load + "(i, a) " + opOperator + " " + load + "(i, b)", std::string("a[i] ") + opOperator + " b[i]");
+
+        function << "\\n}";
+        
+        return function.str();
+    }
+
+    // kernel with one Array operand and one scalar operand, which comes first if scalarFirst
+    inline std::string makeScalarKernelFunction(const char* name, const char* typeName, const char opOperator, const bool scalarFirst, const cl_uint width = 1) {
+        std::ostringstream function;
+
+        function << "__kernel void " << name << "(";
+        if (scalarFirst) function << "const " << typeName << " a, __global const " << typeName << "* b, ";
+        else function << "__global const " << typeName << "* a, const " << typeName << " b, ";
+        function << "__global " << typeName << "* c, const ulong s) {";
+
+        // the scalar is broadcast to every lane of the vector
+        const std::string load = "vload" + std::to_string(width) + (scalarFirst ? "(i, b)" : "(i, a)");
+        const std::string op = std::string(" ") + opOperator + " ";
+        writeElementwiseLoops(function, width, scalarFirst ? "a" + op + load : load + op + "b", scalarFirst ? "a" + op + "b[i]" : "a[i]" + op + "b");
+
+        function << "\\n}";
+
+        return function.str();
+    }
+
+    // kernel calling an OpenCL built-in function, or applying an operator if isOperator, on operands named a0, a1, ...,
+    // bit i of scalars is set if ai is a scalar, which is broadcast to every lane of the vector,
+    // the result is converted as integer abs returns the unsigned type
+    inline std::string makeMathKernelFunction(const char* name, const char* typeName, const char* builtin, const bool isOperator, const size_t operands, const unsigned scalars, const cl_uint width = 1) {
+        std::ostringstream function;
+
+        function << "__kernel void " << name << "(";
+        for (size_t i = 0; i < operands; i++) {
+            if (scalars & (1u << i)) function << "const " << typeName << " a" << i << ", ";
+            else function << "__global const " << typeName << "* a" << i << ", ";
+        }
+        function << "__global " << typeName << "* c, const ulong s) {";
+
+        const std::string vectorType = typeName + std::to_string(width);
+        std::string vectorOperands[3], scalarOperands[3];
+        for (size_t i = 0; i < operands; i++) {
+            const std::string operand = "a" + std::to_string(i);
+
+            if (scalars & (1u << i)) {
+                vectorOperands[i] = "(" + vectorType + ")(" + operand + ")";
+                scalarOperands[i] = operand;
+            } else {
+                vectorOperands[i] = "vload" + std::to_string(width) + "(i, " + operand + ")";
+                scalarOperands[i] = operand + "[i]";
+            }
+        }
+
+        // vectors shift by the count modulo the bits of an element, but scalars smaller than int are promoted first,
+        // so the count is masked for both to give the elements at the end the same results
+        const bool shift = isOperator && (builtin[0] == '<' || builtin[0] == '>');
+        const std::string countMask = std::string(" & (") + typeName + ")(sizeof(" + typeName + ") * 8 - 1))";
+
+        auto call = [&](const std::string* x) {
+            if (shift) return "(" + x[0] + " " + builtin + " (" + x[1] + countMask + ")";
+            if (isOperator) return (operands == 1) ? builtin + x[0] : "(" + x[0] + " " + builtin + " " + x[1] + ")";
+
+            std::string expr = std::string(builtin) + "(";
+            for (size_t i = 0; i < operands; i++) expr += x[i] + ((i + 1 < operands) ? ", " : "");
+            return expr + ")";
+        };
+        writeElementwiseLoops(function, width, "convert_" + vectorType + "(" + call(vectorOperands) + ")", call(scalarOperands));
+
+        function << "\\n}";
+
+        return function.str();
+    }
+
+    // kernel writing 1 to the uchar mask c where a compareOperator b holds and 0 elsewhere, b is a scalar if scalarB,
+    // vector comparisons give -1 where they hold, so they are negated
+    inline std::string makeCompareKernelFunction(const char* name, const char* typeName, const char* compareOperator, const bool scalarB, const cl_uint width = 1) {
         std::ostringstream function;
 
+        function << "__kernel void " << name << "(__global const " << typeName << "* a, ";
+        if (scalarB) function << "const " << typeName << " b, ";
+        else function << "__global const " << typeName << "* b, ";
+        function << "__global uchar* c, const ulong s) {";
+
+        const std::string load = "vload" + std::to_string(width);
+        const std::string op = std::string(" ") + compareOperator + " ";
+        writeElementwiseLoops(
+            function, width,
+            "convert_uchar" + std::to_string(width) + "(-(" + load + "(i, a)" + op + (scalarB ? "b" : load + "(i, b)") + "))",
+            "a[i]" + op + (scalarB ? "b" : "b[i]")
+        );
+
+        function << "\\n}";
+
+        return function.str();
+    }
+
+    // kernel writing a where the uchar mask m isn't 0 and b elsewhere, b is a scalar if operands is 1 and a if it is 2,
+    // vector select takes the mask as the signed integer type of the same size as typeName, maskName
+    inline std::string makeSelectKernelFunction(const char* name, const char* typeName, const char* maskName, const int operands, const cl_uint width = 1) {
+        std::ostringstream function;
+
+        function << "__kernel void " << name << "(__global const uchar* m, ";
+        if (operands == 2) function << "const " << typeName << " a, ";
+        else function << "__global const " << typeName << "* a, ";
+        if (operands == 1) function << "const " << typeName << " b, ";
+        else function << "__global const " << typeName << "* b, ";
+        function << "__global " << typeName << "* c, const ulong s) {";
+
+        const std::string w = std::to_string(width);
+        const std::string vectorA = (operands == 2) ? "(" + std::string(typeName) + w + ")(a)" : "vload" + w + "(i, a)";
+        const std::string vectorB = (operands == 1) ? "(" + std::string(typeName) + w + ")(b)" : "vload" + w + "(i, b)";
+        writeElementwiseLoops(
+            function, width,
+            "select(" + vectorB + ", " + vectorA + ", convert_" + maskName + w + "(vload" + w + "(i, m)) != 0)",
+            std::string("m[i] ? ") + ((operands == 2) ? "a" : "a[i]") + " : " + ((operands == 1) ? "b" : "b[i]")
+        );
+
+        function << "\\n}";
+
+        return function.str();
+    }
+
+    // kernel for a fused expression, operands are named a0, a1, ... in expression
+    inline std::string makeExprKernelFunction(const char* name, const char* typeName, const size_t operands, const std::string& expression) {
+        std::ostringstream function;
+
+        function << "__kernel void " << name << "(";
+        for (size_t i = 0; i < operands; i++) {
+            function << "__global const " << typeName << "* a" << i << ", ";
+        }
+
+        function << "__global " << typeName << "* c, const ulong s) {";
+        writeElementwiseLoops(function, 1, "", expression);
+        function << "\\n}";
+
+        return function.str();
+    }
+
+    // one stage of a reduction, every work-group reduces its part of a (or a * b) in local memory
+    // and writes one partial result to c, so running it again on c with one work-group finishes the reduction
+    // combine is either a function such as min, or an operator such as +
+    inline std::string makeReduceKernelFunction(const char* name, const char* typeName, const char* identity, const char* combine, const bool isFunction, const bool dot) {
+        std::ostringstream function;
+
+        auto combined = [&](const char* x, const char* y) {
+            return isFunction
+                ? std::string(combine) + "(" + x + ", " + y + ")"
+                : std::string(x) + " " + combine + " " + y
+            ;
+        };
+
+        function << "__kernel void " << name << "(__global const " << typeName << "* a, ";
+        if (dot) function << "__global const " << typeName << "* b, ";
+
         function
-            << "__kernel void " << name << "(__global const " << typeName << "* a, __global const " << typeName << "* b, __global " << typeName << "* c, const ulong s) {"
-            << "\\n    int gid = get_global_id(0);"
-            << "\\n    if (gid < s) c[gid] = a[gid] " << opOperator << " b[gid];"
+            << "__global " << typeName << "* c, __local " << typeName << "* scratch, const ulong s) {"
+            << "\\n    const size_t lid = get_local_id(0);"
+            << "\\n    " << typeName << " acc = " << identity << ";"
+            << "\\n    for (size_t i = get_global_id(0); i < s; i += get_global_size(0)) acc = " << combined("acc", dot ? "a[i] * b[i]" : "a[i]") << ";"
+            << "\\n    scratch[lid] = acc;"
+            << "\\n    barrier(CLK_LOCAL_MEM_FENCE);"
+            << "\\n    for (size_t stride = get_local_size(0) / 2; stride > 0; stride /= 2) {"
+            << "\\n        if (lid < stride) scratch[lid] = " << combined("scratch[lid]", "scratch[lid + stride]") << ";"
+            << "\\n        barrier(CLK_LOCAL_MEM_FENCE);"
+            << "\\n    }"
+            << "\\n    if (lid == 0) c[get_group_id(0)] = scratch[0];"
             << "\\n}"
         ;
-        
+
         return function.str();
     }
 
@@ -43,6 +252,18 @@ namespace ezcl {
         }
     }
 
+    // FNV-1a, used where a hash has to stay the same across processes and standard libraries
+    inline uint64_t stableHash(const std::string& str) {
+        uint64_t hash = 14695981039346656037ull;
+
+        for (unsigned char ch : str) {
+            hash ^= ch;
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
     class DeviceId {
         private:
             cl_device_id _id;
@@ -74,6 +295,9 @@ namespace ezcl {
             std::string version() const {
                 return getInfoString(CL_DEVICE_VERSION);
             }
+            std::string driverVersion() const {
+                return getInfoString(CL_DRIVER_VERSION);
+            }
 
             cl_device_id id() const {
                 return _id;
@@ -93,6 +317,17 @@ namespace ezcl {
                 clGetDeviceInfo(_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(mem), &mem, nullptr);
                 return mem;
             }
+            size_t maxWorkGroupSize() const {
+                size_t wg;
+                clGetDeviceInfo(_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(wg), &wg, nullptr);
+                return wg;
+            }
+            // in bits, sub-buffers have to start at a multiple of it
+            cl_uint memBaseAddrAlign() const {
+                cl_uint align;
+                clGetDeviceInfo(_id, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(align), &align, nullptr);
+                return align;
+            }
             
             std::string typeString() const {
                 cl_device_type t = type();
@@ -188,6 +423,237 @@ namespace ezcl {
 
         return platforms;
     }
+`;
+
+    // tables describing every supported type and operation, in the order of numType and opType
+    source += "\n    enum NumType : int {";
+    for (const _numType of numType) {
+        if (_numType === "FLOAT16") continue; // unsupported
+        source += `\n        ${_numType},`;
+    }
+    source += "\n    };\n\n    enum OpType : int {";
+    for (const _opType of opType) {
+        source += `\n        ${opMeta[_opType].capsName},`;
+    }
+    source += "\n    };\n\n    enum MathType : int {";
+    for (const _mathType of mathType) {
+        source += `\n        ${mathMeta[_mathType].capsName},`;
+    }
+    source += "\n    };\n\n    enum CompareType : int {";
+    for (const _compareType of compareType) {
+        source += `\n        ${compareMeta[_compareType].capsName},`;
+    }
+    source += "\n    };\n\n    enum ReduceType : int {";
+    for (const _reduceType of reduceType) {
+        source += `\n        ${reduceMeta[_reduceType].capsName},`;
+    }
+    source += `
+    };
+
+    struct NumInfo {
+        const char* className;
+        const char* numName; // C++ type
+        const char* clName;  // OpenCL C type
+        const char* minName; // smallest value, in OpenCL C
+        const char* maxName; // largest value, in OpenCL C
+        cl_device_info vectorWidthInfo; // query for the preferred vector width
+        const char* maskName; // OpenCL C signed integer type of the same size, which vector comparisons return
+    };
+
+    struct OpInfo {
+        const char* name;
+        char op;
+    };
+
+    struct MathInfo {
+        const char* name;
+        const char* floatFunction; // OpenCL C built-in for floating point types, nullptr if there is none
+        const char* intFunction;   // OpenCL C built-in for integer types, nullptr if there is none
+        size_t operands;
+        bool commutative;
+        bool isOperator;           // the functions are OpenCL C operators such as &
+    };
+
+    struct CompareInfo {
+        const char* name;
+        const char* op;
+    };
+
+    constexpr NumInfo numInfo[] = {`;
+    for (const _numType of numType) {
+        if (_numType === "FLOAT16") continue; // unsupported
+        source += `\n        {"${numMeta[_numType].className}", "${numMeta[_numType].numName}", "${numMeta[_numType].clName}", "${numMeta[_numType].minName}", "${numMeta[_numType].maxName}", ${numMeta[_numType].vectorWidthInfo}, "${numMeta[_numType].maskName}"},`;
+    }
+    source += "\n    };\n\n    constexpr OpInfo opInfo[] = {";
+    for (const _opType of opType) {
+        source += `\n        {"${opMeta[_opType].name}", '${opMeta[_opType].op}'},`;
+    }
+    source += "\n    };\n\n    constexpr MathInfo mathInfo[] = {";
+    for (const _mathType of mathType) {
+        const meta = mathMeta[_mathType];
+        const quoted = (str) => str ? `"${str}"` : "nullptr";
+        source += `\n        {"${meta.name}", ${quoted(meta.floatFunction)}, ${quoted(meta.intFunction)}, ${meta.operands}, ${meta.commutative}, ${meta.isOperator}},`;
+    }
+    source += "\n    };\n\n    constexpr CompareInfo compareInfo[] = {";
+    for (const _compareType of compareType) {
+        source += `\n        {"${compareMeta[_compareType].name}", "${compareMeta[_compareType].op}"},`;
+    }
+    source += "\n    };\n\n    constexpr const char* reduceNames[] = {";
+    for (const _reduceType of reduceType) {
+        source += `\n        "${reduceMeta[_reduceType].name}",`;
+    }
+    source += `
+    };
+
+    inline std::string kernelName(OpType op, NumType type, cl_uint width = 1) {
+        std::string name = std::string(opInfo[op].name) + "_" + numInfo[type].className;
+        if (width > 1) name += "_v" + std::to_string(width);
+        return name;
+    }
+    inline std::string kernelName(MathType m, NumType type, cl_uint width = 1) {
+        std::string name = std::string(mathInfo[m].name) + "_" + numInfo[type].className;
+        if (width > 1) name += "_v" + std::to_string(width);
+        return name;
+    }
+    inline std::string kernelName(CompareType cmp, NumType type, cl_uint width = 1) {
+        std::string name = std::string(compareInfo[cmp].name) + "_" + numInfo[type].className;
+        if (width > 1) name += "_v" + std::to_string(width);
+        return name;
+    }
+
+    // widths vload/vstore support, the 3 element vectors are left out
+    constexpr inline bool validVectorWidth(cl_uint width) {
+        return width == 1 || width == 2 || width == 4 || width == 8 || width == 16;
+    }
+
+    // maps a C++ type to its NumType
+    template <typename T>
+    struct NumTypeOf;
+`;
+    for (const _numType of numType) {
+        if (_numType === "FLOAT16") continue; // unsupported
+        source += `\n    template <> struct NumTypeOf<${numMeta[_numType].numName}> {static constexpr NumType value = ${_numType};};`;
+    }
+    source += `
+
+    // T where it isn't deduced from, so scalar operands convert to the type of the Arrays
+    template <typename T>
+    using Scalar = typename std::common_type<T>::type;
+
+    // wraps cl_event, the handle returned by every asynchronous operation
+    class Event {
+        private:
+            cl_event event;
+
+            static void CL_CALLBACK callbackTrampoline(cl_event, cl_int status, void* data) {
+                std::function<void(cl_int)>* callback = static_cast<std::function<void(cl_int)>*>(data);
+                (*callback)(status);
+                delete callback;
+            }
+
+        public:
+            Event() : event(nullptr) {}
+            explicit Event(cl_event e) : event(e) {} // takes ownership of e
+            Event(const Event& other) : event(other.event) {
+                if (event) clRetainEvent(event);
+            }
+            Event(Event&& other) : event(other.event) {
+                other.event = nullptr;
+            }
+
+            cl_event get() const {return event;}
+            bool valid() const {return event != nullptr;}
+
+            void wait() const {
+                if (event) checkErr(clWaitForEvents(1, &event), "clWaitForEvents");
+            }
+
+            bool complete() const {
+                if (!event) return true;
+
+                cl_int status;
+                checkErr(clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr), "clGetEventInfo");
+                if (status < 0) checkErr(status, "event");
+                return status == CL_COMPLETE;
+            }
+
+            // callback is called with CL_COMPLETE, or a negative error code if the command failed,
+            // usually from a thread owned by the OpenCL implementation, so it must not throw
+            void then(std::function<void(cl_int)> callback) const {
+                if (!event) {
+                    callback(CL_COMPLETE);
+                    return;
+                }
+
+                std::function<void(cl_int)>* heapCallback = new std::function<void(cl_int)>(std::move(callback));
+                cl_int err = clSetEventCallback(event, CL_COMPLETE, callbackTrampoline, heapCallback);
+
+                if (err != CL_SUCCESS) {
+                    delete heapCallback;
+                    checkErr(err, "clSetEventCallback");
+                }
+            }
+
+            std::future<void> future() const {
+                std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+                std::future<void> result = promise->get_future();
+
+                then([promise](cl_int status) {
+                    if (status == CL_COMPLETE) {
+                        promise->set_value();
+                    } else {
+                        promise->set_exception(std::make_exception_ptr(std::runtime_error(
+                            std::string("Error: event (") + std::to_string(status) + std::string(")\\n")
+                        )));
+                    }
+                });
+
+                return result;
+            }
+
+            static void waitAll(const std::vector<Event>& events);
+
+            Event& operator=(const Event& other) {
+                if (this != &other) {
+                    if (other.event) clRetainEvent(other.event);
+                    if (event) clReleaseEvent(event);
+                    event = other.event;
+                }
+
+                return *this;
+            }
+            Event& operator=(Event&& other) {
+                if (this != &other) {
+                    if (event) clReleaseEvent(event);
+                    event = other.event;
+                    other.event = nullptr;
+                }
+
+                return *this;
+            }
+
+            operator cl_event() const {
+                return event;
+            }
+
+            ~Event() {
+                if (event) {
+                    clReleaseEvent(event);
+                    event = nullptr;
+                }
+            }
+    }; // class Event
+
+    // an Event is laid out exactly like a cl_event, so a std::vector<Event> can be handed to OpenCL as a wait list
+    static_assert(sizeof(Event) == sizeof(cl_event), "Event must only wrap a cl_event");
+
+    inline const cl_event* eventList(const std::vector<Event>& events) {
+        return events.empty() ? nullptr : reinterpret_cast<const cl_event*>(events.data());
+    }
+
+    inline void Event::waitAll(const std::vector<Event>& events) {
+        if (!events.empty()) checkErr(clWaitForEvents(static_cast<cl_uint>(events.size()), eventList(events)), "clWaitForEvents");
+    }
 
     enum AccessType : int {
         READ_WRITE = CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
@@ -195,6 +661,122 @@ namespace ezcl {
         WRITE_ONLY = CL_MEM_WRITE_ONLY | CL_MEM_COPY_HOST_PTR,
     };
 
+    // where the memory of an Array lives, for Arrays the host can map without a copy
+    enum HostMemory : int {
+        ALLOC_HOST = CL_MEM_ALLOC_HOST_PTR, // allocated by OpenCL in host-accessible memory
+        USE_HOST = CL_MEM_USE_HOST_PTR,     // memory provided by the caller
+    };
+
+    // the work enqueued on an Array that work on other queues has to wait for,
+    // only tracked when its Device uses several queues, and shared with its slices
+    struct ArrayEvents {
+        Event write;              // the last write
+        std::vector<Event> reads; // the reads since
+        mutable std::mutex lock;  // several threads may read the Array at once
+
+        // adds what reading the Array has to wait for to deps
+        void beforeRead(std::vector<Event>& deps) const {
+            std::lock_guard<std::mutex> guard(lock);
+            if (write.valid()) deps.push_back(write);
+        }
+        // adds what writing the Array has to wait for to deps
+        void beforeWrite(std::vector<Event>& deps) const {
+            std::lock_guard<std::mutex> guard(lock);
+            if (write.valid()) deps.push_back(write);
+            deps.insert(deps.end(), reads.begin(), reads.end());
+        }
+
+        void read(const Event& e) {
+            std::lock_guard<std::mutex> guard(lock);
+
+            // an Array that is only ever read would collect events forever, so finished ones are dropped now and then
+            if (reads.size() >= 16) {
+                reads.erase(std::remove_if(reads.begin(), reads.end(), [](const Event& r) {
+                    cl_int status = CL_COMPLETE;
+                    clGetEventInfo(r.get(), CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+                    return status <= CL_COMPLETE;
+                }), reads.end());
+            }
+            reads.push_back(e);
+        }
+        void written(const Event& e) {
+            std::lock_guard<std::mutex> guard(lock);
+            write = e;
+            reads.clear();
+        }
+    };
+
+    // a mapped region of an Array, unmapped when destroyed or by unmap()
+    template <typename T>
+    class Mapping {
+        private:
+            cl_command_queue queue;
+            cl_mem mem;
+            T* ptr;
+            size_t size_;
+            std::shared_ptr<ArrayEvents> events; // the Array's, if its Device tracks them
+
+            cl_int release() {
+                cl_event event = nullptr;
+                cl_int err = clEnqueueUnmapMemObject(queue, mem, ptr, 0, nullptr, events ? &event : nullptr);
+                if (err == CL_SUCCESS && events) {
+                    events->written(Event(event));
+                    clFlush(queue);
+                }
+                return err;
+            }
+
+        public:
+            Mapping() = delete;
+            Mapping(const Mapping&) = delete;
+            Mapping(cl_command_queue q, cl_mem m, T* p, size_t s, std::shared_ptr<ArrayEvents> e = nullptr) : queue(q), mem(m), ptr(p), size_(s), events(std::move(e)) {}
+            Mapping(Mapping&& other) : queue(other.queue), mem(other.mem), ptr(other.ptr), size_(other.size_), events(std::move(other.events)) {
+                other.ptr = nullptr;
+                other.size_ = 0;
+            }
+
+            T* data() const {return ptr;}
+            size_t size() const {return size_;}
+            T* begin() const {return ptr;}
+            T* end() const {return ptr + size_;}
+            T& operator[](size_t i) const {return ptr[i];}
+
+            #ifdef __cpp_lib_span
+                std::span<T> span() const {return std::span<T>(ptr, size_);}
+                operator std::span<T>() const {return span();}
+            #endif
+
+            void unmap() {
+                if (ptr) {
+                    cl_int err = release();
+                    ptr = nullptr;
+                    size_ = 0;
+                    checkErr(err, "clEnqueueUnmapMemObject");
+                }
+            }
+
+            Mapping& operator=(const Mapping&) = delete;
+            Mapping& operator=(Mapping&& other) {
+                if (this != &other) {
+                    if (ptr) release();
+
+                    queue = other.queue;
+                    mem = other.mem;
+                    ptr = other.ptr;
+                    size_ = other.size_;
+                    events = std::move(other.events);
+                    other.ptr = nullptr;
+                    other.size_ = 0;
+                }
+
+                return *this;
+            }
+
+            ~Mapping() {
+                if (ptr) release();
+            }
+    }; // class Mapping
+
     // required for Array::Array(Device& dev, AccessType acc, const std::vector<T>& dat)
     class Device;
 
@@ -205,6 +787,24 @@ namespace ezcl {
             cl_mem data;
             AccessType access;
             size_t size_;
+            size_t capacity; // bytes of the pooled buffer, 0 if the buffer doesn't belong to the Device's pool
+            std::shared_ptr<ArrayEvents> events; // created with the Array, so threads using it at once don't race to create it
+
+            // wraps a sub-buffer created by slice, which shares the events of the Array it is part of
+            Array(Device& dev, AccessType acc, cl_mem mem, const size_t s, std::shared_ptr<ArrayEvents> e) : device(dev), data(mem), access(acc), size_(s), capacity(0), events(std::move(e)) {}
+
+            // never lazily created, so threads submitting work on the same Array don't race to create it
+            ArrayEvents& tracked() {
+                return *events;
+            }
+
+            // has to be defined after Device class definition
+            // returns the queue for a transfer of this Array, and adds what it has to wait for to deps
+            cl_command_queue transferBefore(std::vector<Event>& deps, bool writing);
+            // takes ownership of the transfer's event, records it when the Device tracks events, and profiles it as key
+            Event transferAfter(cl_event event, bool writing, const char* key);
+
+            friend class Device;
 
         public:
             Array() = delete;
@@ -215,9 +815,19 @@ namespace ezcl {
             template <size_t S>
             Array(Device& dev, AccessType acc, const std::array<T, S>& dat);
             Array(Device& dev, AccessType acc, const T* dat, const size_t s);
-            Array(Array&& other) : device(other.device), data(other.data), access(other.access), size_(other.size_) {
+            // allocates s uninitialized elements on the device, without a host copy
+            Array(Device& dev, AccessType acc, const size_t s);
+            // allocates s elements on the device and sets every one to value
+            Array(Device& dev, AccessType acc, const size_t s, const T& value);
+            // allocates s uninitialized elements in host-accessible memory, hm must be ALLOC_HOST
+            Array(Device& dev, AccessType acc, const size_t s, HostMemory hm);
+            // with ALLOC_HOST, copies dat into host-accessible memory,
+            // with USE_HOST, uses dat itself, which has to outlive the Array
+            Array(Device& dev, AccessType acc, T* dat, const size_t s, HostMemory hm);
+            Array(Array&& other) : device(other.device), data(other.data), access(other.access), size_(other.size_), capacity(other.capacity), events(other.events) {
                 other.data = nullptr;
                 other.size_ = 0;
+                other.capacity = 0;
             }
             
             const Device& getDevice() const {return device;}
@@ -227,32 +837,52 @@ namespace ezcl {
             size_t size() const {return size_;}
 
             // has to be defined after Device class definition
+            // a std::vector is only resized when its size differs, so reused vectors are never reallocated
             void read(std::vector<T>& v);
             template <size_t S>
             void read(std::array<T, S>& a);
-            void read(T* dat, const size_t s);
+            // reads s elements starting at element offset
+            void read(T* dat, const size_t s, const size_t offset = 0);
+            #ifdef __cpp_lib_span
+                void read(std::span<T> sp, const size_t offset = 0);
+            #endif
+
+            // the target has to stay alive and untouched until the returned Event completes
+            Event readAsync(std::vector<T>& v, const std::vector<Event>& waitList = {});
+            template <size_t S>
+            Event readAsync(std::array<T, S>& a, const std::vector<Event>& waitList = {});
+            Event readAsync(T* dat, const size_t s, const std::vector<Event>& waitList = {});
+            Event readAsync(T* dat, const size_t s, const size_t offset, const std::vector<Event>& waitList = {});
+            #ifdef __cpp_lib_span
+                Event readAsync(std::span<T> sp, const size_t offset, const std::vector<Event>& waitList = {});
+            #endif
+
+            // uploads into the existing buffer starting at element offset, so it can be reused across iterations
+            void write(const std::vector<T>& v, const size_t offset = 0);
+            template <size_t S>
+            void write(const std::array<T, S>& a, const size_t offset = 0);
+            void write(const T* dat, const size_t s, const size_t offset = 0);
+
+            // the source has to stay alive and untouched until the returned Event completes
+            Event writeAsync(const std::vector<T>& v, const std::vector<Event>& waitList = {});
+            template <size_t S>
+            Event writeAsync(const std::array<T, S>& a, const std::vector<Event>& waitList = {});
+            Event writeAsync(const T* dat, const size_t s, const size_t offset = 0, const std::vector<Event>& waitList = {});
+
+            // a view of count elements from offset that every operation accepts, sharing this Array's memory
+            // without a copy, offset * sizeof(T) has to be a multiple of the device's CL_DEVICE_MEM_BASE_ADDR_ALIGN
+            Array slice(const size_t offset, const size_t count);
+
+            // blocks until count elements from offset are mapped into host memory, which costs no copy
+            // for ALLOC_HOST and USE_HOST Arrays on devices sharing memory with the host
+            Mapping<T> map(cl_map_flags flags = CL_MAP_READ | CL_MAP_WRITE);
+            Mapping<T> map(const size_t offset, const size_t count, cl_map_flags flags = CL_MAP_READ | CL_MAP_WRITE);
             
             Array& operator=(const Array&) = delete;
-            Array& operator=(Array&& other) {
-                if (this != &other) {
-                    if (data) clReleaseMemObject(data);
-
-                    data = other.data;
-                    access = other.access;
-                    size_ = other.size_;
-                    other.data = nullptr;
-                    other.size_ = 0;
-                }
-                
-                return *this;
-            }
+            // has to be defined after Device class definition, buffers go back to the Device's pool
+            Array& operator=(Array&& other);
 
-            ~Array() {
-                if (data) {
-                    clReleaseMemObject(data);
-                    data = nullptr;
-                }
-            }
+            ~Array();
     }; // class Array
 
     enum AccessMethod : bool {
@@ -268,105 +898,1742 @@ namespace ezcl {
         else return (at == READ_ONLY);
     }
 
+    // expression templates, built by the arithmetic operators on Arrays and evaluated as a single kernel by Device::eval
+    template <typename T>
+    struct ArrayExpr {
+        using value_type = T;
+        static constexpr size_t leaves = 1;
+
+        Array<T>* array;
+
+        static void shape(std::string& key) {
+            key += 'x';
+        }
+        void source(std::string& expr, size_t& leaf) const {
+            expr += "a" + std::to_string(leaf++) + "[i]";
+        }
+        void collect(Array<T>** arrays, size_t& leaf) const {
+            arrays[leaf++] = array;
+        }
+    };
+
+    template <OpType Op, typename L, typename R>
+    struct BinaryExpr {
+        using value_type = typename L::value_type;
+        static_assert(std::is_same<value_type, typename R::value_type>::value, "all Arrays in an expression must have the same type");
+        static constexpr size_t leaves = L::leaves + R::leaves;
+
+        L lhs;
+        R rhs;
+
+        // prefix notation, unambiguous because every operation takes two operands
+        static void shape(std::string& key) {
+            key += opInfo[Op].name;
+            key += '_';
+            L::shape(key);
+            key += '_';
+            R::shape(key);
+        }
+        // every intermediate result is cast back to the element type, so results match the unfused operations
+        void source(std::string& expr, size_t& leaf) const {
+            expr += "((";
+            expr += numInfo[NumTypeOf<value_type>::value].clName;
+            expr += ")(";
+            lhs.source(expr, leaf);
+            expr += ' ';
+            expr += opInfo[Op].op;
+            expr += ' ';
+            rhs.source(expr, leaf);
+            expr += "))";
+        }
+        void collect(Array<value_type>** arrays, size_t& leaf) const {
+            lhs.collect(arrays, leaf);
+            rhs.collect(arrays, leaf);
+        }
+    };
+
+    template <typename X>
+    struct IsExpr : std::false_type {};
+    template <typename T>
+    struct IsExpr<ArrayExpr<T>> : std::true_type {};
+    template <OpType Op, typename L, typename R>
+    struct IsExpr<BinaryExpr<Op, L, R>> : std::true_type {};
+
+    // Arrays can only be operands as lvalues, an expression only stores a pointer to them
+    template <typename X>
+    struct IsExprOperand : IsExpr<std::decay_t<X>> {};
+    template <typename T>
+    struct IsExprOperand<Array<T>&> : std::true_type {};
+
+    template <typename T>
+    ArrayExpr<T> toExpr(Array<T>& a) {return {&a};}
+    template <typename E, std::enable_if_t<IsExpr<E>::value, int> = 0>
+    const E& toExpr(const E& e) {return e;}
+
+    template <typename X>
+    using ExprOf = std::decay_t<decltype(toExpr(std::declval<X&>()))>;
+`;
+    for (const _opType of opType) {
+        source += `
+    template <typename L, typename R, std::enable_if_t<IsExprOperand<L>::value && IsExprOperand<R>::value, int> = 0>
+    BinaryExpr<${opMeta[_opType].capsName}, ExprOf<L>, ExprOf<R>> operator${opMeta[_opType].op}(L&& lhs, R&& rhs) {
+        return {toExpr(lhs), toExpr(rhs)};
+    }
+`;
+    }
+    source += `
+    struct PoolStats {
+        size_t hits = 0;          // Arrays that got a buffer from the pool
+        size_t misses = 0;        // Arrays that had to allocate a new buffer
+        size_t bytesPooled = 0;   // bytes of the free buffers held by the pool
+        size_t buffersPooled = 0; // free buffers held by the pool
+
+        double hitRate() const {return (hits + misses) ? static_cast<double>(hits) / (hits + misses) : 0.0;}
+    };
+
+    // nanoseconds
+    struct ProfileTiming {
+        cl_ulong total = 0;
+        cl_ulong min = 0;
+        cl_ulong max = 0;
+        cl_ulong p50 = 0;
+        cl_ulong p99 = 0;
+    };
+
+    struct ProfileStats {
+        size_t count = 0;         // completed commands
+        ProfileTiming queued;     // from being enqueued to being submitted to the device
+        ProfileTiming submitted;  // from being submitted to starting
+        ProfileTiming running;    // from starting to ending
+        ProfileTiming overall;    // from being enqueued to ending
+    };
+
+    // sorts samples
+    inline ProfileTiming makeProfileTiming(std::vector<cl_ulong>& samples) {
+        ProfileTiming timing;
+        if (samples.empty()) return timing;
+
+        std::sort(samples.begin(), samples.end());
+        for (cl_ulong sample : samples) timing.total += sample;
+        timing.min = samples.front();
+        timing.max = samples.back();
+        timing.p50 = samples[(samples.size() - 1) / 2];
+        timing.p99 = samples[(samples.size() - 1) * 99 / 100];
+        return timing;
+    }
+
+    struct BinaryCacheStats {
+        size_t hits = 0;   // programs loaded from a cached binary
+        size_t misses = 0; // programs built from source because no matching binary was cached
+    };
+
     class Device {
         private:
             cl_platform_id platform;
             cl_device_id device;
             cl_context context;
             cl_command_queue queue;
+            std::vector<cl_command_queue> extraQueues; // further compute queues, operations take turns
+            cl_command_queue transferQueue;            // for reads and writes of Arrays, nullptr to use queue
+            std::atomic<size_t> nextQueue;
+
+            // a kernel of a built program, arguments are set on kernel objects, so every thread launching it
+            // at the same time takes its own kernel object from idle, or creates one
+            struct KernelPool {
+                std::string key;
+                cl_program program = nullptr;
+                cl_uint width = 1; // vector width of elementwise kernels
+                std::mutex lock;
+                std::vector<cl_kernel> idle;
+                size_t leases = 0; // with EZCL_NO_CACHE, the pool and its program go away with the last lease
+
+                ~KernelPool() {
+                    for (cl_kernel kernel : idle) clReleaseKernel(kernel);
+                }
+            };
+
+            std::mutex buildMutex; // programs are built one at a time, so none is built twice
 
             #ifndef EZCL_NO_CACHE
-                std::unordered_map<std::string, cl_program> programCache;
-                std::unordered_map<std::string, cl_kernel> kernelCache;
+                std::unordered_map<std::string, cl_program> programCache; // guarded by buildMutex
+                std::shared_mutex poolsMutex; // guards kernelPools, lookups share it
+                std::unordered_map<std::string, std::unique_ptr<KernelPool>> kernelPools;
+            #endif
+
+            // which operands an elementwise kernel takes, with three operands ARRAY_SCALAR makes both the others scalars,
+            // for select the mask doesn't count
+            enum Operands : int {
+                ARRAYS,
+                ARRAY_SCALAR,
+                SCALAR_ARRAY,
+            };
+
+            #ifndef EZCL_NO_CACHE
+                // the pools of the elementwise kernels by function (every OpType, MathType and CompareType, then select),
+                // type, Operands and vector width, so finding one is an array index, set once and owned by kernelPools
+                static constexpr size_t elementwiseFunctions = std::size(opInfo) + std::size(mathInfo) + std::size(compareInfo) + 1;
+                static constexpr size_t elementwiseSlots = elementwiseFunctions * std::size(numInfo) * 3 * 5;
+                std::unique_ptr<std::atomic<KernelPool*>[]> elementwiseKernels;
+            #endif
+
+            cl_uint computeUnits;
+            size_t maxWorkGroupSize;
+            cl_uint vectorWidths[std::size(numInfo)];
+
+            std::string deviceTag; // identifies the device and driver, for anything persisted across processes
+            std::string buildOptions;
+
+            #ifndef EZCL_NO_BINARY_CACHE
+                std::string binaryCacheDir;
+                BinaryCacheStats binaryCacheStats;
+            #endif
+
+            bool autotune;
+            std::atomic<bool> tuningUsed; // autotune is on or a kernel is tuned, otherwise launches skip looking up their local size
+            std::shared_mutex tuningMutex; // guards localSizes
+            std::unordered_map<std::string, size_t> localSizes; // tuned local work size per kernel key, 0 leaves it to the driver
+            std::unordered_set<std::string> uncheckedSizes; // keys of localSizes from the tuning file or older build options, checked on first launch
+            std::string tuningFile;
+
+            struct PooledBuffer {
+                cl_mem mem;
+                Event ready; // with several queues, completes once the work enqueued by the previous Array has
+            };
+
+            // free buffers by flags and size class, which Arrays take instead of calling clCreateBuffer
+            std::map<std::pair<cl_mem_flags, size_t>, std::vector<PooledBuffer>> pool;
+            size_t poolLimit;     // most bytes the pool holds
+            size_t poolMaxBuffer; // larger buffers are never pooled
+            PoolStats poolStats;
+            std::mutex poolMutex; // guards pool and poolStats
+
+            struct TimedCommand {
+                std::string key;
+                Event event;
+                std::chrono::steady_clock::time_point enqueued;
+            };
+
+            bool profiling;
+            bool timeCommands; // the queues have profiling enabled, for profiling or tracing
+            std::mutex timingMutex; // guards pendingProfiles, profileSamples and traceEvents
+            std::vector<TimedCommand> pendingProfiles; // commands whose times haven't been read yet
+            size_t collectAt = 1024; // pendingProfiles size at which the completed ones are collected
+            std::unordered_map<std::string, std::vector<std::array<cl_ulong, 4>>> profileSamples; // queued, submit, start and end times per key
+
+            #ifndef EZCL_NO_TRACE
+                struct TraceEvent {
+                    std::string name;
+                    const char* category;
+                    size_t track;    // 0 for the host, then one per queue
+                    double start;    // microseconds since tracing started
+                    double duration; // microseconds
+                    double queued;   // for commands, microseconds from being enqueued until starting
+                };
+
+                bool tracing;
+                std::chrono::steady_clock::time_point traceStart;
+                std::vector<TraceEvent> traceEvents;
             #endif`;
     source += `
-            
-            cl_program buildProgram(const std::string& src, const std::string& key) {
-                cl_int err;
-                
-                #ifndef EZCL_NO_CACHE
-                    auto it = programCache.find(key);
-                    if (it != programCache.end()) return it->second;
-                #endif
 
-                const char* csrc = src.c_str();
-                cl_program program = clCreateProgramWithSource(context, 1, &csrc, nullptr, &err);
-                checkErr(err, "clCreateProgramWithSource");
-                err = clBuildProgram(program, 1, &device, nullptr, nullptr, nullptr);
-                checkErr(err, "clBuildProgram");
+            // Arrays draw their buffers from and return them to the pool
+            template <typename T>
+            friend class Array;
 
-                #ifndef EZCL_NO_CACHE
-                    programCache[key] = program;
+            // sizes are rounded up to a quarter of their power of two, so no more than a fifth of a pooled buffer is unused
+            static size_t poolSizeClass(size_t bytes) {
+                if (bytes <= 256) return 256;
+
+                size_t step = 1;
+                while (step <= (bytes - 1) / 2) step *= 2;
+                step = std::max<size_t>(step / 4, 64);
+
+                return (bytes + step - 1) / step * step;
+            }
+
+            // capacity is set to the bytes of the returned buffer, or 0 if it can't go back to the pool,
+            // work on the buffer has to wait for ready
+            cl_mem acquireBuffer(cl_mem_flags flags, size_t bytes, size_t& capacity, Event& ready) {
+                cl_int err;
+                capacity = 0;
+
+                if (bytes <= poolMaxBuffer && poolLimit > 0) {
+                    capacity = poolSizeClass(bytes);
+
+                    std::lock_guard<std::mutex> lock(poolMutex);
+                    auto it = pool.find({flags, capacity});
+                    if (it != pool.end() && !it->second.empty()) {
+                        cl_mem mem = it->second.back().mem;
+                        ready = std::move(it->second.back().ready);
+                        it->second.pop_back();
+                        poolStats.hits++;
+                        poolStats.bytesPooled -= capacity;
+                        poolStats.buffersPooled--;
+                        return mem;
+                    }
+
+                    poolStats.misses++;
+                }
+
+                cl_mem mem = clCreateBuffer(context, flags, capacity ? capacity : bytes, nullptr, &err);
+                checkErr(err, "clCreateBuffer");
+                return mem;
+            }
+
+            void recycleBuffer(cl_mem mem, cl_mem_flags flags, size_t capacity, const ArrayEvents* events) {
+                // called from Array's destructor, so running out of memory releases the buffer instead of throwing
+                bool pooled = false;
+                try {
+                    pooled = poolBuffer(mem, flags, capacity, events);
+                } catch (const std::bad_alloc&) {}
+
+                if (!pooled) clReleaseMemObject(mem);
+            }
+
+            // returns whether the pool took mem,
+            // with one queue, work enqueued on a reused buffer runs after everything enqueued on its previous Array anyway,
+            // with several, the next Array waits for a marker of the previous one's outstanding work
+            bool poolBuffer(cl_mem mem, cl_mem_flags flags, size_t capacity, const ArrayEvents* events) {
+                if (capacity == 0 || poolLimit == 0) return false;
+
+                Event ready;
+                if (events) {
+                    std::vector<Event> deps;
+                    events->beforeWrite(deps);
+
+                    if (!deps.empty()) {
+                        cl_event marker;
+                        if (clEnqueueMarkerWithWaitList(queue, static_cast<cl_uint>(deps.size()), eventList(deps), &marker) != CL_SUCCESS) return false;
+                        ready = Event(marker);
+                        clFlush(queue);
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(poolMutex);
+                if (poolStats.bytesPooled + capacity > poolLimit) return false;
+
+                pool[{flags, capacity}].push_back({mem, std::move(ready)});
+                poolStats.bytesPooled += capacity;
+                poolStats.buffersPooled++;
+                return true;
+            }
+
+            cl_command_queue createQueue() {
+                cl_int err;
+                const cl_queue_properties props[] = {CL_QUEUE_PROPERTIES, timeCommands ? static_cast<cl_queue_properties>(CL_QUEUE_PROFILING_ENABLE) : 0, 0};
+                cl_command_queue q = clCreateCommandQueueWithProperties(context, device, props, &err);
+                checkErr(err, "clCreateCommandQueueWithProperties");
+                return q;
+            }
+
+            // keeps the command's event until its times can be read
+            void profile(const std::string& key, const Event& event) {
+                std::lock_guard<std::mutex> lock(timingMutex);
+                pendingProfiles.push_back({key, event, std::chrono::steady_clock::now()});
+                if (pendingProfiles.size() >= collectAt) collectProfiles(false);
+            }
+
+            // recreates the queues with or without profiling enabled once that changes
+            void updateTimed() {
+                bool needed = profiling;
+                #ifndef EZCL_NO_TRACE
+                    needed = needed || tracing;
+                #endif
+                if (needed == timeCommands) return;
+
+                finish();
+                timeCommands = needed;
+
+                const cl_uint computeQueues = getComputeQueueCount();
+                const bool transfer = hasTransferQueue();
+                releaseQueues();
+                clReleaseCommandQueue(queue);
+                queue = nullptr;
+
+                queue = createQueue();
+                setQueues(computeQueues, transfer);
+            }
+
+            #ifndef EZCL_NO_TRACE
+                // records a host span from construction to destruction while the Device traces
+                class HostSpan {
+                    private:
+                        Device* device;
+                        const char* category;
+                        const char* name;
+                        std::chrono::steady_clock::time_point start;
+
+                    public:
+                        HostSpan(Device& dev, const char* c, const char* n) : device(dev.tracing ? &dev : nullptr), category(c), name(n) {
+                            if (device) start = std::chrono::steady_clock::now();
+                        }
+                        HostSpan(const HostSpan&) = delete;
+                        HostSpan& operator=(const HostSpan&) = delete;
+
+                        ~HostSpan() {
+                            if (!device) return;
+
+                            const std::chrono::duration<double, std::micro> begin = start - device->traceStart;
+                            const std::chrono::duration<double, std::micro> duration = std::chrono::steady_clock::now() - start;
+                            std::lock_guard<std::mutex> lock(device->timingMutex);
+                            device->traceEvents.push_back({name, category, 0, begin.count(), duration.count(), 0.0});
+                        }
+                };
+
+                size_t queueTrack(cl_command_queue q) const {
+                    if (q == queue) return 1;
+                    for (size_t i = 0; i < extraQueues.size(); i++)
+                        if (q == extraQueues[i]) return i + 2;
+                    return extraQueues.size() + 2;
+                }
+            #endif
+
+            // reads the times of the completed commands, or waits for all of them with wait, callers hold timingMutex
+            void collectProfiles(bool wait) {
+                size_t kept = 0;
+
+                for (size_t i = 0; i < pendingProfiles.size(); i++) {
+                    const cl_event event = pendingProfiles[i].event.get();
+
+                    cl_int status = CL_COMPLETE;
+                    if (wait) clWaitForEvents(1, &event);
+                    clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr);
+
+                    if (status > CL_COMPLETE) {
+                        if (kept != i) pendingProfiles[kept] = std::move(pendingProfiles[i]);
+                        kept++;
+                        continue;
+                    }
+                    if (status < 0) continue; // failed commands have no times
+
+                    std::array<cl_ulong, 4> times;
+                    const cl_profiling_info infos[] = {CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT, CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END};
+                    bool valid = true;
+                    for (size_t j = 0; j < 4; j++)
+                        valid = valid && clGetEventProfilingInfo(event, infos[j], sizeof(cl_ulong), &times[j], nullptr) == CL_SUCCESS;
+                    if (!valid) continue;
+
+                    if (profiling) profileSamples[pendingProfiles[i].key].push_back(times);
+
+                    #ifndef EZCL_NO_TRACE
+                        // the device clock has its own origin, so each command is placed relative to when the host enqueued it
+                        if (tracing) {
+                            cl_command_queue q = nullptr;
+                            clGetEventInfo(event, CL_EVENT_COMMAND_QUEUE, sizeof(q), &q, nullptr);
+
+                            const std::chrono::duration<double, std::micro> enqueued = pendingProfiles[i].enqueued - traceStart;
+                            const double queued = (times[2] - times[0]) / 1e3;
+                            traceEvents.push_back({pendingProfiles[i].key, "device", queueTrack(q), enqueued.count() + queued, (times[3] - times[2]) / 1e3, queued});
+                        }
+                    #endif
+                }
+
+                pendingProfiles.resize(kept);
+
+                // if the device falls behind, most commands are still running, and checking them all again
+                // on the next launch would cost every launch as much as there are pending commands
+                collectAt = std::max<size_t>(1024, kept * 2);
+            }
+
+            // work on different queues is only ordered by events, which are then tracked per Array
+            bool tracking() const {return transferQueue || !extraQueues.empty();}
+
+            cl_command_queue computeQueue() {
+                if (extraQueues.empty()) return queue;
+
+                const size_t i = nextQueue.fetch_add(1, std::memory_order_relaxed) % (extraQueues.size() + 1);
+                return i ? extraQueues[i - 1] : queue;
+            }
+            cl_command_queue copyQueue() const {return transferQueue ? transferQueue : queue;}
+
+            // when tracking, the next compute queue is returned and deps is set to waitList and whatever else the kernel has to wait for,
+            // otherwise the kernel goes to queue and only waits for waitList
+            template <typename T, typename U>
+            cl_command_queue trackBefore(Array<T>* const* inputs, size_t count, Array<U>& output, const std::vector<Event>& waitList, std::vector<Event>& deps) {
+                if (!tracking()) return queue;
+
+                deps = waitList;
+                for (size_t i = 0; i < count; i++) inputs[i]->tracked().beforeRead(deps);
+                output.tracked().beforeWrite(deps);
+                return computeQueue();
+            }
+
+            // records the kernel's event on its Arrays and hands it to the caller if event isn't nullptr
+            template <typename T, typename U>
+            void trackAfter(Array<T>* const* inputs, size_t count, Array<U>& output, cl_command_queue q, cl_event kernelEvent, cl_event* event) {
+                if (!tracking()) {
+                    if (event) *event = kernelEvent;
+                    return;
+                }
+
+                if (event) clRetainEvent(kernelEvent);
+                const Event e(kernelEvent);
+                for (size_t i = 0; i < count; i++) inputs[i]->tracked().read(e);
+                output.tracked().written(e);
+                if (event) *event = kernelEvent;
+
+                // queues waiting on this one can only progress once it is flushed
+                clFlush(q);
+            }
+
+            void releaseQueues() {
+                for (cl_command_queue q : extraQueues) clReleaseCommandQueue(q);
+                extraQueues.clear();
+
+                if (transferQueue) {
+                    clReleaseCommandQueue(transferQueue);
+                    transferQueue = nullptr;
+                }
+            }
+
+            void releasePool() {
+                for (auto& kv : pool)
+                    for (PooledBuffer& buffer : kv.second) clReleaseMemObject(buffer.mem);
+                pool.clear();
+                poolStats.bytesPooled = 0;
+                poolStats.buffersPooled = 0;
+            }
+
+            #ifndef EZCL_NO_BINARY_CACHE
+                // header written in front of every cached binary, a binary is only reused if it matches exactly
+                std::string binaryHeader(const std::string& src) const {
+                    std::ostringstream header;
+                    header << "ezcl binary\\n" << deviceTag << "\\n" << buildOptions << "\\n" << stableHash(src) << "\\n";
+                    return header.str();
+                }
+
+                std::filesystem::path binaryPath(const std::string& key) const {
+                    std::ostringstream name;
+                    name << key << '-' << std::hex << stableHash(deviceTag + '\\n' + buildOptions) << ".bin";
+                    return std::filesystem::path(binaryCacheDir) / name.str();
+                }
+
+                cl_program loadBinary(const std::string& src, const std::string& key) {
+                    std::ifstream file(binaryPath(key), std::ios::binary);
+                    if (!file) return nullptr;
+
+                    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+                    const std::string header = binaryHeader(src);
+                    if (contents.size() <= header.size() || contents.compare(0, header.size(), header) != 0) return nullptr;
+
+                    const size_t size = contents.size() - header.size();
+                    const unsigned char* binary = reinterpret_cast<const unsigned char*>(contents.data() + header.size());
+
+                    cl_int err, status;
+                    cl_program program = clCreateProgramWithBinary(context, 1, &device, &size, &binary, &status, &err);
+                    if (err != CL_SUCCESS || status != CL_SUCCESS) {
+                        if (program) clReleaseProgram(program);
+                        return nullptr;
+                    }
+
+                    if (clBuildProgram(program, 1, &device, buildOptions.c_str(), nullptr, nullptr) != CL_SUCCESS) {
+                        clReleaseProgram(program);
+                        return nullptr;
+                    }
+
+                    return program;
+                }
+
+                // failing to store a binary only costs a rebuild next time, so errors are ignored
+                void storeBinary(cl_program program, const std::string& src, const std::string& key) {
+                    size_t size = 0;
+                    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size, nullptr) != CL_SUCCESS || size == 0) return;
+
+                    std::vector<unsigned char> binary(size);
+                    unsigned char* binaryPtr = binary.data();
+                    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaryPtr), &binaryPtr, nullptr) != CL_SUCCESS) return;
+
+                    std::error_code ec;
+                    std::filesystem::create_directories(binaryCacheDir, ec);
+
+                    // write to a temporary file first so concurrent processes never read a partial binary
+                    const std::filesystem::path path = binaryPath(key);
+                    std::filesystem::path tmpPath = path;
+                    tmpPath += ".tmp" + std::to_string(stableHash(
+                        std::to_string(reinterpret_cast<uintptr_t>(this)) + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                    ));
+
+                    {
+                        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+                        if (!file) return;
+
+                        const std::string header = binaryHeader(src);
+                        file.write(header.data(), header.size());
+                        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+                        if (!file) return;
+                    }
+
+                    std::filesystem::rename(tmpPath, path, ec);
+                    if (ec) std::filesystem::remove(tmpPath, ec);
+                }
+            #endif
+
+            // callers hold buildMutex
+            cl_program buildProgram(const std::string& src, const std::string& key) {
+                cl_int err;
+
+                #ifndef EZCL_NO_CACHE
+                    auto it = programCache.find(key);
+                    if (it != programCache.end()) return it->second;
+                #endif
+
+                #ifndef EZCL_NO_TRACE
+                    HostSpan span(*this, "compile", key.c_str());
+                #endif
+
+                cl_program program = nullptr;
+
+                #ifndef EZCL_NO_BINARY_CACHE
+                    if (!binaryCacheDir.empty()) {
+                        program = loadBinary(src, key);
+
+                        if (program) binaryCacheStats.hits++;
+                        else binaryCacheStats.misses++;
+                    }
                 #endif
 
-                return program;
+                if (!program) {
+                    const char* csrc = src.c_str();
+                    program = clCreateProgramWithSource(context, 1, &csrc, nullptr, &err);
+                    checkErr(err, "clCreateProgramWithSource");
+                    err = clBuildProgram(program, 1, &device, buildOptions.c_str(), nullptr, nullptr);
+                    checkErr(err, "clBuildProgram");
+
+                    #ifndef EZCL_NO_BINARY_CACHE
+                        if (!binaryCacheDir.empty()) storeBinary(program, src, key);
+                    #endif
+                }
+
+                #ifndef EZCL_NO_CACHE
+                    programCache[key] = program;
+                #endif
+
+                return program;
+            }
+
+            // the pool of the kernel key, makeSource is only called to build its program if nothing is cached
+            template <typename F>
+            KernelPool* kernelPool(const std::string& key, F makeSource, cl_uint width = 1) {
+                #ifndef EZCL_NO_CACHE
+                    {
+                        std::shared_lock<std::shared_mutex> lock(poolsMutex);
+                        auto it = kernelPools.find(key);
+                        if (it != kernelPools.end()) return it->second.get();
+                    }
+                #endif
+
+                std::lock_guard<std::mutex> building(buildMutex);
+
+                #ifndef EZCL_NO_CACHE
+                    // another thread may have built it meanwhile
+                    {
+                        std::shared_lock<std::shared_mutex> lock(poolsMutex);
+                        auto it = kernelPools.find(key);
+                        if (it != kernelPools.end()) return it->second.get();
+                    }
+                #endif
+
+                std::unique_ptr<KernelPool> pool = std::make_unique<KernelPool>();
+                pool->key = key;
+                pool->width = width;
+
+                #ifndef EZCL_NO_CACHE
+                    auto it = programCache.find(key);
+                    pool->program = (it != programCache.end()) ? it->second : buildProgram(makeSource(), key);
+
+                    KernelPool* result = pool.get();
+                    std::unique_lock<std::shared_mutex> lock(poolsMutex);
+                    kernelPools.emplace(key, std::move(pool));
+                    return result;
+                #else
+                    pool->program = buildProgram(makeSource(), key);
+                    return pool.release();
+                #endif
+            }
+
+            // a kernel object of a pool for one launch, back in the pool once destroyed
+            class PooledKernel {
+                private:
+                    KernelPool* pool;
+                    cl_kernel kernel;
+
+                    void giveBack() {
+                        #ifndef EZCL_NO_CACHE
+                            if (!kernel) return;
+
+                            std::lock_guard<std::mutex> lock(pool->lock);
+                            try {
+                                pool->idle.push_back(kernel);
+                            } catch (...) {
+                                clReleaseKernel(kernel);
+                            }
+                        #else
+                            if (kernel) clReleaseKernel(kernel);
+
+                            bool last;
+                            {
+                                std::lock_guard<std::mutex> lock(pool->lock);
+                                last = --pool->leases == 0;
+                            }
+                            if (last) {
+                                clReleaseProgram(pool->program);
+                                delete pool;
+                            }
+                        #endif
+                    }
+
+                public:
+                    explicit PooledKernel(KernelPool* p) : pool(p), kernel(nullptr) {
+                        {
+                            std::lock_guard<std::mutex> lock(pool->lock);
+                            #ifdef EZCL_NO_CACHE
+                                pool->leases++;
+                            #endif
+                            if (!pool->idle.empty()) {
+                                kernel = pool->idle.back();
+                                pool->idle.pop_back();
+                                return;
+                            }
+                        }
+
+                        cl_int err;
+                        kernel = clCreateKernel(pool->program, pool->key.c_str(), &err);
+                        if (err != CL_SUCCESS) {
+                            kernel = nullptr;
+                            giveBack();
+                            checkErr(err, "clCreateKernel");
+                        }
+                    }
+                    PooledKernel(const PooledKernel&) = delete;
+                    PooledKernel& operator=(const PooledKernel&) = delete;
+                    ~PooledKernel() {giveBack();}
+
+                    operator cl_kernel() const {return kernel;}
+                    KernelPool* source() const {return pool;}
+                    const std::string& key() const {return pool->key;}
+                    cl_uint width() const {return pool->width;}
+            };
+
+            // sets mems as the first count arguments and size as the last one
+            void launchKernel(cl_command_queue q, cl_kernel kernel, const std::string& key, const cl_mem* mems, size_t count, size_t size, cl_uint width, const std::vector<Event>& waitList, cl_event* event) {
+                cl_int err;
+                for (size_t i = 0; i < count; i++) {
+                    err = clSetKernelArg(kernel, static_cast<cl_uint>(i), sizeof(cl_mem), &mems[i]);
+                    checkErr(err, "clSetKernelArg");
+                }
+                cl_ulong s = size;
+                err = clSetKernelArg(kernel, static_cast<cl_uint>(count), sizeof(cl_ulong), &s);
+                checkErr(err, "clSetKernelArg s");
+
+                enqueueKernel(q, kernel, key, size, width, mems[count - 1], waitList, event);
+            }
+
+            // enqueues an elementwise kernel over size elements, width at a time, its arguments have to be set already,
+            // the kernels loop, so beyond a few full work-groups per compute unit more work-items only add overhead
+            void enqueueKernel(cl_command_queue q, cl_kernel kernel, const std::string& key, size_t size, cl_uint width, cl_mem output, const std::vector<Event>& waitList, cl_event* event) {
+                const size_t maxWorkItems = computeUnits * maxWorkGroupSize * 4;
+                size_t global_work_size = std::max<size_t>(std::min<size_t>((size + width - 1) / width, maxWorkItems), 1);
+
+                // nothing tuned and nothing to tune leaves it to the driver without hashing the key
+                size_t local_work_size = 0;
+                if (tuningUsed.load(std::memory_order_relaxed)) {
+                    bool found, unchecked = false;
+                    {
+                        std::shared_lock<std::shared_mutex> lock(tuningMutex);
+                        auto it = localSizes.find(key);
+                        found = it != localSizes.end();
+                        if (found) local_work_size = it->second;
+                        if (local_work_size && !uncheckedSizes.empty()) unchecked = uncheckedSizes.count(key) != 0;
+                    }
+
+                    // a size that wasn't tuned for this kernel may be above its work-group size,
+                    // it is dropped so the driver chooses, or the kernel is tuned again
+                    if (unchecked) {
+                        size_t kernelMax = 0;
+                        const bool fits =
+                            clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMax), &kernelMax, nullptr) == CL_SUCCESS &&
+                            local_work_size <= std::min(kernelMax, maxWorkGroupSize)
+                        ;
+
+                        std::unique_lock<std::shared_mutex> lock(tuningMutex);
+                        if (uncheckedSizes.erase(key) && !fits) localSizes.erase(key);
+                        auto it = localSizes.find(key);
+                        found = it != localSizes.end();
+                        local_work_size = found ? it->second : 0;
+                    }
+
+                    // kernels are tuned one at a time, another thread may have tuned this one meanwhile
+                    if (!found && autotune) {
+                        std::unique_lock<std::shared_mutex> lock(tuningMutex);
+                        auto it = localSizes.find(key);
+                        if (it != localSizes.end()) {
+                            local_work_size = it->second;
+                        } else {
+                            local_work_size = localSizes[key] = tuneLocalSize(kernel, global_work_size, output, waitList);
+                            uncheckedSizes.erase(key);
+                            if (!tuningFile.empty()) saveTuning();
+                        }
+                    }
+                }
+
+                // the kernels loop, so rounding up only adds idle work-items
+                if (local_work_size) global_work_size = (global_work_size + local_work_size - 1) / local_work_size * local_work_size;
+
+                #ifndef EZCL_NO_TRACE
+                    HostSpan span(*this, "enqueue", key.c_str());
+                #endif
+
+                cl_event kernelEvent = nullptr;
+                cl_int err = clEnqueueNDRangeKernel(q, kernel, 1, nullptr, &global_work_size, local_work_size ? &local_work_size : nullptr, static_cast<cl_uint>(waitList.size()), eventList(waitList), (event || timeCommands) ? &kernelEvent : nullptr);
+                checkErr(err, "clEnqueueNDRangeKernel");
+
+                if (timeCommands) {
+                    if (event) clRetainEvent(kernelEvent);
+                    profile(key, Event(kernelEvent));
+                }
+                if (event) *event = kernelEvent;
+            }
+
+            // times the kernel with the driver's choice and every power of two multiple of the preferred work-group size multiple,
+            // on a separate profiling queue, and returns the fastest local size, output is swapped for a scratch buffer
+            // meanwhile so Arrays used as both operand and result aren't changed
+            size_t tuneLocalSize(cl_kernel kernel, size_t globalSize, cl_mem output, const std::vector<Event>& waitList) {
+                cl_int err;
+                size_t kernelMax, multiple, outputBytes;
+                cl_uint numArgs;
+                checkErr(clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMax), &kernelMax, nullptr), "clGetKernelWorkGroupInfo");
+                checkErr(clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(multiple), &multiple, nullptr), "clGetKernelWorkGroupInfo");
+                checkErr(clGetKernelInfo(kernel, CL_KERNEL_NUM_ARGS, sizeof(numArgs), &numArgs, nullptr), "clGetKernelInfo");
+                checkErr(clGetMemObjectInfo(output, CL_MEM_SIZE, sizeof(outputBytes), &outputBytes, nullptr), "clGetMemObjectInfo");
+
+                // the operands have to be ready, and the tuning queue isn't ordered with the others
+                Event::waitAll(waitList);
+                finish();
+
+                constexpr cl_queue_properties props[] = {CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0};
+                cl_command_queue tuningQueue = clCreateCommandQueueWithProperties(context, device, props, &err);
+                checkErr(err, "clCreateCommandQueueWithProperties");
+
+                cl_mem scratch = clCreateBuffer(context, CL_MEM_READ_WRITE, outputBytes, nullptr, &err);
+                if (err != CL_SUCCESS) {
+                    clReleaseCommandQueue(tuningQueue);
+                    checkErr(err, "clCreateBuffer");
+                }
+
+                // every elementwise kernel ends with (..., c, s)
+                const cl_uint outputIndex = numArgs - 2;
+                clSetKernelArg(kernel, outputIndex, sizeof(cl_mem), &scratch);
+
+                std::vector<size_t> candidates = {0};
+                for (size_t local = std::max<size_t>(multiple, 1); local <= std::min(kernelMax, maxWorkGroupSize); local *= 2) {
+                    candidates.push_back(local);
+                }
+
+                size_t best = 0;
+                cl_ulong bestTime = ~cl_ulong(0);
+
+                for (size_t local : candidates) {
+                    const size_t global = local ? (globalSize + local - 1) / local * local : globalSize;
+
+                    // the fastest of a few runs, so the first run's warm-up doesn't count
+                    for (int run = 0; run < 3; run++) {
+                        cl_event event;
+                        if (clEnqueueNDRangeKernel(tuningQueue, kernel, 1, nullptr, &global, local ? &local : nullptr, 0, nullptr, &event) != CL_SUCCESS) break;
+
+                        cl_ulong start = 0, end = 0;
+                        const bool timed =
+                            clWaitForEvents(1, &event) == CL_SUCCESS &&
+                            clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) == CL_SUCCESS &&
+                            clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) == CL_SUCCESS
+                        ;
+                        clReleaseEvent(event);
+
+                        if (timed && end - start < bestTime) {
+                            bestTime = end - start;
+                            best = local;
+                        }
+                    }
+                }
+
+                clSetKernelArg(kernel, outputIndex, sizeof(cl_mem), &output);
+                clReleaseMemObject(scratch);
+                clReleaseCommandQueue(tuningQueue);
+
+                return best;
+            }
+
+            // tuning files hold one "device hash, kernel key, local size" line per tuned kernel, for any number of devices
+            void loadTuning() {
+                std::ifstream file(tuningFile);
+                std::ostringstream tag;
+                tag << std::hex << stableHash(deviceTag);
+
+                std::string line;
+                while (std::getline(file, line)) {
+                    std::istringstream fields(line);
+                    std::string lineTag, key;
+                    size_t local;
+
+                    if (fields >> lineTag >> key >> local && lineTag == tag.str()) {
+                        localSizes[key] = local;
+                        if (local) uncheckedSizes.insert(key);
+                        else uncheckedSizes.erase(key);
+                    }
+                }
+            }
+
+            // failing to save only costs tuning again next time, so errors are ignored
+            void saveTuning() {
+                std::ostringstream tag;
+                tag << std::hex << stableHash(deviceTag);
+
+                // keep the lines of other devices
+                std::ostringstream contents;
+                {
+                    std::ifstream file(tuningFile);
+                    std::string line;
+                    while (std::getline(file, line)) {
+                        if (line.compare(0, tag.str().size() + 1, tag.str() + '\\t') != 0) contents << line << '\\n';
+                    }
+                }
+                for (const auto& kv : localSizes) contents << tag.str() << '\\t' << kv.first << '\\t' << kv.second << '\\n';
+
+                std::filesystem::path tmpPath = tuningFile;
+                tmpPath += ".tmp" + std::to_string(stableHash(
+                    std::to_string(reinterpret_cast<uintptr_t>(this)) + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+                ));
+
+                {
+                    std::ofstream file(tmpPath, std::ios::trunc);
+                    if (!file) return;
+                    file << contents.str();
+                    if (!file) return;
+                }
+
+                std::error_code ec;
+                std::filesystem::rename(tmpPath, tuningFile, ec);
+                if (ec) std::filesystem::remove(tmpPath, ec);
+            }
+
+            static constexpr const char* operandSuffixes[] = {"", "_as", "_sa"};
+
+            // the pool of the elementwise kernel for function on type at the current vector width,
+            // only the first call calls find, which formats the key and finds or builds the pool
+            template <typename F>
+            KernelPool* elementwisePool([[maybe_unused]] size_t function, NumType type, [[maybe_unused]] Operands operands, F find) {
+                const cl_uint width = vectorWidths[type];
+
+                #ifndef EZCL_NO_CACHE
+                    size_t w = 0;
+                    while ((1u << w) < width) w++;
+
+                    std::atomic<KernelPool*>& slot = elementwiseKernels[((function * std::size(numInfo) + type) * 3 + operands) * 5 + w];
+                    if (KernelPool* pool = slot.load(std::memory_order_acquire)) return pool;
+                #endif
+
+                KernelPool* pool = find(width);
+
+                #ifndef EZCL_NO_CACHE
+                    slot.store(pool, std::memory_order_release);
+                #endif
+                return pool;
+            }
+
+            KernelPool* opPool(OpType op, NumType type, Operands operands) {
+                return elementwisePool(op, type, operands, [&](cl_uint width) {
+                    const std::string key = kernelName(op, type, width) + operandSuffixes[operands];
+                    return kernelPool(key, [&] {
+                        return (operands == ARRAYS)
+                            ? makeKernelFunction(key.c_str(), numInfo[type].clName, opInfo[op].op, width)
+                            : makeScalarKernelFunction(key.c_str(), numInfo[type].clName, opInfo[op].op, operands == SCALAR_ARRAY, width);
+                    }, width);
+                });
+            }
+
+            KernelPool* mathPool(MathType m, NumType type, Operands operands) {
+                return elementwisePool(std::size(opInfo) + m, type, operands, [&](cl_uint width) {
+                    const MathInfo& math = mathInfo[m];
+                    const bool floating = (type == FLOAT32 || type == FLOAT64);
+
+                    unsigned scalars = 0;
+                    for (size_t i = 0; i < math.operands; i++) {
+                        if ((operands == ARRAY_SCALAR && i > 0) || (operands == SCALAR_ARRAY && i == 0)) scalars |= 1u << i;
+                    }
+
+                    const std::string key = kernelName(m, type, width) + operandSuffixes[operands];
+                    return kernelPool(key, [&] {
+                        return makeMathKernelFunction(key.c_str(), numInfo[type].clName, floating ? math.floatFunction : math.intFunction, math.isOperator, math.operands, scalars, width);
+                    }, width);
+                });
+            }
+
+            KernelPool* comparePool(CompareType cmp, NumType type, Operands operands) {
+                return elementwisePool(std::size(opInfo) + std::size(mathInfo) + cmp, type, operands, [&](cl_uint width) {
+                    const std::string key = kernelName(cmp, type, width) + operandSuffixes[operands];
+                    return kernelPool(key, [&] {
+                        return makeCompareKernelFunction(key.c_str(), numInfo[type].clName, compareInfo[cmp].op, operands == ARRAY_SCALAR, width);
+                    }, width);
+                });
+            }
+
+            KernelPool* selectPool(NumType type, Operands operands) {
+                return elementwisePool(std::size(opInfo) + std::size(mathInfo) + std::size(compareInfo), type, operands, [&](cl_uint width) {
+                    std::string key = std::string("select_") + numInfo[type].className;
+                    if (width > 1) key += "_v" + std::to_string(width);
+                    key += operandSuffixes[operands];
+
+                    return kernelPool(key, [&] {
+                        return makeSelectKernelFunction(key.c_str(), numInfo[type].clName, numInfo[type].maskName, operands, width);
+                    }, width);
+                });
+            }
+
+            template <typename T>
+            void binaryOp(OpType op, NumType type, Array<T>& a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList, cl_event* event) {
+                if (!checkAccess(a, READ) || !checkAccess(b, READ) || !checkAccess(c, WRITE)) {
+                    throw std::runtime_error("invalid Array access permissions");
+                }
+
+                if ((a.getSize() != c.getSize()) || (b.getSize() != c.getSize())) {
+                    throw std::runtime_error("all Arrays must be the same size");
+                }
+
+                PooledKernel kernel(opPool(op, type, ARRAYS));
+                const cl_mem mems[] = {a.getMem(), b.getMem(), c.getMem()};
+
+                Array<T>* inputs[] = {&a, &b};
+                std::vector<Event> deps;
+                cl_command_queue q = trackBefore(inputs, 2, c, waitList, deps);
+                cl_event kernelEvent = nullptr;
+                launchKernel(q, kernel, kernel.key(), mems, 3, c.getSize(), kernel.width(), tracking() ? deps : waitList, (event || tracking()) ? &kernelEvent : nullptr);
+                trackAfter(inputs, 2, c, q, kernelEvent, event);
+            }
+
+            // a is the Array operand, scalar is the other operand, and comes first if scalarFirst
+            template <typename T>
+            void scalarOp(OpType op, NumType type, Array<T>& a, const T scalar, const bool scalarFirst, Array<T>& c, const std::vector<Event>& waitList, cl_event* event) {
+                if (!checkAccess(a, READ) || !checkAccess(c, WRITE)) {
+                    throw std::runtime_error("invalid Array access permissions");
+                }
+
+                if (a.getSize() != c.getSize()) {
+                    throw std::runtime_error("all Arrays must be the same size");
+                }
+
+                PooledKernel kernel(opPool(op, type, scalarFirst ? SCALAR_ARRAY : ARRAY_SCALAR));
+
+                cl_int err;
+                err = clSetKernelArg(kernel, scalarFirst ? 1 : 0, sizeof(cl_mem), &a.getMem());
+                checkErr(err, "clSetKernelArg");
+                err = clSetKernelArg(kernel, scalarFirst ? 0 : 1, sizeof(T), &scalar);
+                checkErr(err, "clSetKernelArg scalar");
+                err = clSetKernelArg(kernel, 2, sizeof(cl_mem), &c.getMem());
+                checkErr(err, "clSetKernelArg c");
+                cl_ulong s = c.getSize();
+                err = clSetKernelArg(kernel, 3, sizeof(cl_ulong), &s);
+                checkErr(err, "clSetKernelArg s");
+
+                Array<T>* inputs[] = {&a};
+                std::vector<Event> deps;
+                cl_command_queue q = trackBefore(inputs, 1, c, waitList, deps);
+                cl_event kernelEvent = nullptr;
+                enqueueKernel(q, kernel, kernel.key(), c.getSize(), kernel.width(), c.getMem(), tracking() ? deps : waitList, (event || tracking()) ? &kernelEvent : nullptr);
+                trackAfter(inputs, 1, c, q, kernelEvent, event);
+            }
+
+            template <MathType M, typename T, size_t N>
+            static constexpr void checkMath() {
+                static_assert(mathInfo[M].operands == N, "wrong number of operands for this function");
+                static_assert(mathInfo[M].intFunction != nullptr || std::is_floating_point<T>::value, "this function only takes float and double Arrays");
+                static_assert(mathInfo[M].floatFunction != nullptr || !std::is_floating_point<T>::value, "this function only takes integer Arrays");
+            }
+
+            // arrays are the Array operands and scalars the scalar operands, each in order, which of the operands are scalars follows from operands
+            template <typename T>
+            void mathOp(MathType m, Array<T>* const* arrays, size_t count, const T* scalars, Operands operands, Array<T>& c, const std::vector<Event>& waitList, cl_event* event) {
+                for (size_t i = 0; i < count; i++) {
+                    if (!checkAccess(*arrays[i], READ)) throw std::runtime_error("invalid Array access permissions");
+                    if (arrays[i]->getSize() != c.getSize()) throw std::runtime_error("all Arrays must be the same size");
+                }
+                if (!checkAccess(c, WRITE)) {
+                    throw std::runtime_error("invalid Array access permissions");
+                }
+
+                PooledKernel kernel(mathPool(m, NumTypeOf<T>::value, operands));
+
+                cl_int err;
+                size_t array = 0, scalar = 0;
+                for (size_t i = 0; i < mathInfo[m].operands; i++) {
+                    const cl_uint index = static_cast<cl_uint>(i);
+                    if ((operands == ARRAY_SCALAR && i > 0) || (operands == SCALAR_ARRAY && i == 0)) {
+                        err = clSetKernelArg(kernel, index, sizeof(T), &scalars[scalar++]);
+                        checkErr(err, "clSetKernelArg scalar");
+                    } else {
+                        err = clSetKernelArg(kernel, index, sizeof(cl_mem), &arrays[array++]->getMem());
+                        checkErr(err, "clSetKernelArg");
+                    }
+                }
+                const cl_uint outputIndex = static_cast<cl_uint>(mathInfo[m].operands);
+                err = clSetKernelArg(kernel, outputIndex, sizeof(cl_mem), &c.getMem());
+                checkErr(err, "clSetKernelArg c");
+                cl_ulong s = c.getSize();
+                err = clSetKernelArg(kernel, outputIndex + 1, sizeof(cl_ulong), &s);
+                checkErr(err, "clSetKernelArg s");
+
+                std::vector<Event> deps;
+                cl_command_queue q = trackBefore(arrays, count, c, waitList, deps);
+                cl_event kernelEvent = nullptr;
+                enqueueKernel(q, kernel, kernel.key(), c.getSize(), kernel.width(), c.getMem(), tracking() ? deps : waitList, (event || tracking()) ? &kernelEvent : nullptr);
+                trackAfter(arrays, count, c, q, kernelEvent, event);
+            }
+
+            // b is the scalar operand if b is nullptr
+            template <typename T>
+            void compareOp(CompareType cmp, Array<T>& a, Array<T>* b, const T scalar, Array<unsigned char>& mask, const std::vector<Event>& waitList, cl_event* event) {
+                if (!checkAccess(a, READ) || (b && !checkAccess(*b, READ)) || !checkAccess(mask, WRITE)) {
+                    throw std::runtime_error("invalid Array access permissions");
+                }
+
+                if ((a.getSize() != mask.getSize()) || (b && b->getSize() != mask.getSize())) {
+                    throw std::runtime_error("all Arrays must be the same size");
+                }
+
+                PooledKernel kernel(comparePool(cmp, NumTypeOf<T>::value, b ? ARRAYS : ARRAY_SCALAR));
+
+                cl_int err;
+                err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &a.getMem());
+                checkErr(err, "clSetKernelArg");
+                if (b) err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &b->getMem());
+                else err = clSetKernelArg(kernel, 1, sizeof(T), &scalar);
+                checkErr(err, "clSetKernelArg b");
+                err = clSetKernelArg(kernel, 2, sizeof(cl_mem), &mask.getMem());
+                checkErr(err, "clSetKernelArg c");
+                cl_ulong s = mask.getSize();
+                err = clSetKernelArg(kernel, 3, sizeof(cl_ulong), &s);
+                checkErr(err, "clSetKernelArg s");
+
+                Array<T>* inputs[] = {&a, b};
+                std::vector<Event> deps;
+                cl_command_queue q = trackBefore(inputs, b ? 2 : 1, mask, waitList, deps);
+                cl_event kernelEvent = nullptr;
+                enqueueKernel(q, kernel, kernel.key(), mask.getSize(), kernel.width(), mask.getMem(), tracking() ? deps : waitList, (event || tracking()) ? &kernelEvent : nullptr);
+                trackAfter(inputs, b ? 2 : 1, mask, q, kernelEvent, event);
+            }
+
+            // a or b is the scalar operand if it is nullptr
+            template <typename T>
+            void selectOp(Array<unsigned char>& mask, Array<T>* a, Array<T>* b, const T scalar, Array<T>& c, const std::vector<Event>& waitList, cl_event* event) {
+                if (!checkAccess(mask, READ) || (a && !checkAccess(*a, READ)) || (b && !checkAccess(*b, READ)) || !checkAccess(c, WRITE)) {
+                    throw std::runtime_error("invalid Array access permissions");
+                }
+
+                if ((mask.getSize() != c.getSize()) || (a && a->getSize() != c.getSize()) || (b && b->getSize() != c.getSize())) {
+                    throw std::runtime_error("all Arrays must be the same size");
+                }
+
+                PooledKernel kernel(selectPool(NumTypeOf<T>::value, !a ? SCALAR_ARRAY : !b ? ARRAY_SCALAR : ARRAYS));
+
+                cl_int err;
+                err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &mask.getMem());
+                checkErr(err, "clSetKernelArg mask");
+                if (a) err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &a->getMem());
+                else err = clSetKernelArg(kernel, 1, sizeof(T), &scalar);
+                checkErr(err, "clSetKernelArg a");
+                if (b) err = clSetKernelArg(kernel, 2, sizeof(cl_mem), &b->getMem());
+                else err = clSetKernelArg(kernel, 2, sizeof(T), &scalar);
+                checkErr(err, "clSetKernelArg b");
+                err = clSetKernelArg(kernel, 3, sizeof(cl_mem), &c.getMem());
+                checkErr(err, "clSetKernelArg c");
+                cl_ulong s = c.getSize();
+                err = clSetKernelArg(kernel, 4, sizeof(cl_ulong), &s);
+                checkErr(err, "clSetKernelArg s");
+
+                // the mask has another type, so it is tracked here and the others by trackBefore and trackAfter
+                Array<T>* inputs[2];
+                size_t count = 0;
+                if (a) inputs[count++] = a;
+                if (b) inputs[count++] = b;
+
+                std::vector<Event> deps;
+                cl_command_queue q = trackBefore(inputs, count, c, waitList, deps);
+                if (tracking()) mask.tracked().beforeRead(deps);
+
+                cl_event kernelEvent = nullptr;
+                enqueueKernel(q, kernel, kernel.key(), c.getSize(), kernel.width(), c.getMem(), tracking() ? deps : waitList, (event || tracking()) ? &kernelEvent : nullptr);
+
+                if (tracking()) {
+                    clRetainEvent(kernelEvent);
+                    mask.tracked().read(Event(kernelEvent));
+                }
+                trackAfter(inputs, count, c, q, kernelEvent, event);
+            }
+
+            // largest power of two work-group size the kernel can run with, the tree reduction needs a power of two
+            size_t reduceGroupSize(cl_kernel kernel) const {
+                size_t kernelMax;
+                checkErr(clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernelMax), &kernelMax, nullptr), "clGetKernelWorkGroupInfo");
+
+                const size_t limit = std::min<size_t>(std::min(kernelMax, maxWorkGroupSize), 256);
+                size_t groupSize = 1;
+                while (groupSize * 2 <= limit) groupSize *= 2;
+                return groupSize;
+            }
+
+            template <typename T>
+            void launchReduce(cl_command_queue q, cl_kernel kernel, const std::string& key, const cl_mem* mems, size_t count, size_t groupSize, size_t groups, size_t size, const std::vector<Event>& waitList) {
+                cl_int err;
+                for (size_t i = 0; i < count; i++) {
+                    err = clSetKernelArg(kernel, static_cast<cl_uint>(i), sizeof(cl_mem), &mems[i]);
+                    checkErr(err, "clSetKernelArg");
+                }
+                err = clSetKernelArg(kernel, static_cast<cl_uint>(count), sizeof(T) * groupSize, nullptr);
+                checkErr(err, "clSetKernelArg scratch");
+                cl_ulong s = size;
+                err = clSetKernelArg(kernel, static_cast<cl_uint>(count + 1), sizeof(cl_ulong), &s);
+                checkErr(err, "clSetKernelArg s");
+
+                const size_t global_work_size = groups * groupSize;
+
+                #ifndef EZCL_NO_TRACE
+                    HostSpan span(*this, "enqueue", key.c_str());
+                #endif
+
+                cl_event event = nullptr;
+                err = clEnqueueNDRangeKernel(q, kernel, 1, nullptr, &global_work_size, &groupSize, static_cast<cl_uint>(waitList.size()), eventList(waitList), timeCommands ? &event : nullptr);
+                checkErr(err, "clEnqueueNDRangeKernel");
+                if (timeCommands) profile(key, Event(event));
+            }
+
+            // two stages: a few work-groups per compute unit reduce a into partial results,
+            // then a single work-group reduces those, so only one element is read back
+            template <typename T>
+            T reduceArray(ReduceType r, Array<T>& a, Array<T>* b) {
+                if (!checkAccess(a, READ) || (b && !checkAccess(*b, READ))) {
+                    throw std::runtime_error("invalid Array access permissions");
+                }
+
+                if (b && b->getSize() != a.getSize()) {
+                    throw std::runtime_error("all Arrays must be the same size");
+                }
+
+                if (a.getSize() == 0) {
+                    if (r == MIN || r == MAX) throw std::runtime_error("cannot find the min or max of an empty Array");
+                    return T();
+                }
+
+                const NumInfo& num = numInfo[NumTypeOf<T>::value];
+                const bool isFunction = (r == MIN || r == MAX);
+                const char* identity = (r == MIN) ? num.maxName : (r == MAX) ? num.minName : "0";
+                const char* combine = (r == MIN) ? "min" : (r == MAX) ? "max" : "+";
+
+                const std::string kernelKey = std::string("reduce_") + reduceNames[r] + "_" + num.className;
+                PooledKernel kernel(kernelPool(kernelKey, [&] {
+                    return makeReduceKernelFunction(kernelKey.c_str(), num.clName, identity, combine, isFunction, r == DOT);
+                }));
+
+                // the partial results of a dot product are summed
+                const std::string finalKey = (r == DOT) ? std::string("reduce_") + reduceNames[SUM] + "_" + num.className : kernelKey;
+                PooledKernel finalKernel((r != DOT) ? kernel.source() : kernelPool(finalKey, [&] {
+                    return makeReduceKernelFunction(finalKey.c_str(), num.clName, "0", "+", false, false);
+                }));
+
+                const size_t groupSize = reduceGroupSize(kernel);
+                const size_t groups = std::min<size_t>((a.getSize() + groupSize - 1) / groupSize, computeUnits * 4);
+
+                cl_int err;
+                cl_mem partials = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(T) * groups, nullptr, &err);
+                checkErr(err, "clCreateBuffer");
+
+                T result;
+
+                // every stage runs on one queue, and the result is read blocking, so only the inputs have to be waited for
+                std::vector<Event> deps;
+                cl_command_queue q = queue;
+                if (tracking()) {
+                    a.tracked().beforeRead(deps);
+                    if (b) b->tracked().beforeRead(deps);
+                    q = computeQueue();
+                }
+
+                try {
+                    if (b) {
+                        const cl_mem mems[] = {a.getMem(), b->getMem(), partials};
+                        launchReduce<T>(q, kernel, kernelKey, mems, 3, groupSize, groups, a.getSize(), deps);
+                    } else {
+                        const cl_mem mems[] = {a.getMem(), partials};
+                        launchReduce<T>(q, kernel, kernelKey, mems, 2, groupSize, groups, a.getSize(), deps);
+                    }
+
+                    // the single work-group reads every partial result before writing the first one
+                    if (groups > 1) {
+                        const cl_mem mems[] = {partials, partials};
+                        launchReduce<T>(q, finalKernel, finalKey, mems, 2, reduceGroupSize(finalKernel), 1, groups, {});
+                    }
+
+                    #ifndef EZCL_NO_TRACE
+                        HostSpan span(*this, "read", kernelKey.c_str());
+                    #endif
+
+                    err = clEnqueueReadBuffer(q, partials, CL_TRUE, 0, sizeof(T), &result, 0, nullptr, nullptr);
+                    checkErr(err, "clEnqueueReadBuffer");
+                } catch (...) {
+                    clReleaseMemObject(partials);
+                    throw;
+                }
+
+                clReleaseMemObject(partials);
+
+                return result;
+            }
+
+            template <typename T, typename E>
+            void evalExpr(Array<T>& c, const E& expr, const std::vector<Event>& waitList, cl_event* event) {
+                Array<T>* arrays[E::leaves];
+                size_t leaf = 0;
+                expr.collect(arrays, leaf);
+
+                for (Array<T>* a : arrays) {
+                    if (!checkAccess(*a, READ)) throw std::runtime_error("invalid Array access permissions");
+                    if (a->getSize() != c.getSize()) throw std::runtime_error("all Arrays must be the same size");
+                }
+                if (!checkAccess(c, WRITE)) throw std::runtime_error("invalid Array access permissions");
+
+                // the key only depends on the shape of the expression, which is its type
+                static const std::string kernelKey = [] {
+                    std::string key = std::string("eval_") + numInfo[NumTypeOf<T>::value].className + "_";
+                    E::shape(key);
+                    return key;
+                }();
+
+                // the source is only generated when the kernel isn't cached
+                PooledKernel kernel(kernelPool(kernelKey, [&] {
+                    std::string expression;
+                    leaf = 0;
+                    expr.source(expression, leaf);
+                    return makeExprKernelFunction(kernelKey.c_str(), numInfo[NumTypeOf<T>::value].clName, E::leaves, expression);
+                }));
+
+                cl_mem mems[E::leaves + 1];
+                for (size_t i = 0; i < E::leaves; i++) mems[i] = arrays[i]->getMem();
+                mems[E::leaves] = c.getMem();
+
+                std::vector<Event> deps;
+                cl_command_queue q = trackBefore(arrays, E::leaves, c, waitList, deps);
+                cl_event kernelEvent = nullptr;
+                launchKernel(q, kernel, kernelKey, mems, E::leaves + 1, c.getSize(), 1, tracking() ? deps : waitList, (event || tracking()) ? &kernelEvent : nullptr);
+                trackAfter(arrays, E::leaves, c, q, kernelEvent, event);
+            }
+            `;
+    source += `
+        public:
+            Device() : platform(nullptr), device(nullptr), context(nullptr), queue(nullptr), transferQueue(nullptr), nextQueue(0), computeUnits(1), maxWorkGroupSize(1), autotune(false), tuningUsed(false), poolLimit(0), poolMaxBuffer(0), profiling(false), timeCommands(false) {
+                std::fill(std::begin(vectorWidths), std::end(vectorWidths), 1);
+
+                #ifndef EZCL_NO_CACHE
+                    elementwiseKernels.reset(new std::atomic<KernelPool*>[elementwiseSlots]());
+                #endif
+
+                #ifndef EZCL_NO_TRACE
+                    tracing = false;
+                #endif
+            }
+            Device(const Device&) = delete;
+            Device(cl_platform_id pf, cl_device_id dev, bool precompileAll = false) : platform(pf), device(dev), transferQueue(nullptr), nextQueue(0), autotune(false), tuningUsed(false), profiling(false), timeCommands(false) {
+                #ifndef EZCL_NO_TRACE
+                    tracing = false;
+                #endif
+
+                #ifndef EZCL_NO_CACHE
+                    elementwiseKernels.reset(new std::atomic<KernelPool*>[elementwiseSlots]());
+                #endif
+
+                cl_int err; 
+                context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
+                checkErr(err, "clCreateContext");
+
+                queue = createQueue();
+
+                const DeviceId id(device);
+                computeUnits = std::max<cl_uint>(id.computeUnits(), 1);
+                maxWorkGroupSize = std::max<size_t>(id.maxWorkGroupSize(), 1);
+
+                // pooling is opt-in through setPoolLimit, since pooled buffers are rounded up and kept from the driver,
+                // once on it takes buffers of up to a thirty-second of the device's memory
+                poolLimit = 0;
+                poolMaxBuffer = static_cast<size_t>(id.memSize() / 32);
+
+                // largest valid width not above the preferred one, a device without doubles prefers 0
+                for (size_t i = 0; i < std::size(numInfo); i++) {
+                    cl_uint preferred = 1;
+                    clGetDeviceInfo(device, numInfo[i].vectorWidthInfo, sizeof(preferred), &preferred, nullptr);
+
+                    vectorWidths[i] = 1;
+                    while (vectorWidths[i] < 16 && vectorWidths[i] * 2 <= preferred) vectorWidths[i] *= 2;
+                }
+
+                deviceTag = id.name() + '\\n' + id.vendor() + '\\n' + id.version() + '\\n' + id.driverVersion();
+
+                #ifndef EZCL_NO_BINARY_CACHE
+                    if (const char* dir = std::getenv("EZCL_BINARY_CACHE_DIR")) binaryCacheDir = dir;
+                #endif
+
+                if (precompileAll) precompile();
+            }
+            Device(Device&& other) {
+                platform = other.platform;
+                device = other.device;
+                context = other.context;
+                queue = other.queue;
+                extraQueues = std::move(other.extraQueues);
+                transferQueue = other.transferQueue;
+                nextQueue = other.nextQueue.load();
+                profiling = other.profiling;
+                timeCommands = other.timeCommands;
+                pendingProfiles = std::move(other.pendingProfiles);
+                collectAt = other.collectAt;
+                profileSamples = std::move(other.profileSamples);
+
+                #ifndef EZCL_NO_TRACE
+                    tracing = other.tracing;
+                    traceStart = other.traceStart;
+                    traceEvents = std::move(other.traceEvents);
+                #endif
+
+                computeUnits = other.computeUnits;
+                maxWorkGroupSize = other.maxWorkGroupSize;
+                std::copy(std::begin(other.vectorWidths), std::end(other.vectorWidths), vectorWidths);
+                deviceTag = std::move(other.deviceTag);
+                buildOptions = std::move(other.buildOptions);
+                autotune = other.autotune;
+                tuningUsed = other.tuningUsed.load();
+                localSizes = std::move(other.localSizes);
+                uncheckedSizes = std::move(other.uncheckedSizes);
+                tuningFile = std::move(other.tuningFile);
+                pool = std::move(other.pool);
+                poolLimit = other.poolLimit;
+                poolMaxBuffer = other.poolMaxBuffer;
+                poolStats = other.poolStats;
+                other.pool.clear();
+
+                #ifndef EZCL_NO_CACHE
+                    programCache = std::move(other.programCache);
+                    kernelPools = std::move(other.kernelPools);
+                    elementwiseKernels = std::move(other.elementwiseKernels);
+                    other.programCache.clear();
+                    other.kernelPools.clear();
+                #endif
+
+                #ifndef EZCL_NO_BINARY_CACHE
+                    binaryCacheDir = std::move(other.binaryCacheDir);
+                    binaryCacheStats = other.binaryCacheStats;
+                #endif
+
+                other.context = nullptr;
+                other.queue = nullptr;
+                other.extraQueues.clear();
+                other.transferQueue = nullptr;
+            }
+            
+            const cl_platform_id& getPlatform() {return platform;}
+            const cl_device_id& getDevice() {return device;}
+            const cl_context& getContext() {return context;}
+            const cl_command_queue& getQueue() {return queue;}
+
+            // options passed to clBuildProgram for every program built after this call,
+            // the tuned local sizes are checked again since the kernels may then allow smaller work-groups
+            void setBuildOptions(const std::string& options) {
+                buildOptions = options;
+
+                std::unique_lock<std::shared_mutex> lock(tuningMutex);
+                for (const auto& kv : localSizes) {
+                    if (kv.second) uncheckedSizes.insert(kv.first);
+                }
+            }
+            const std::string& getBuildOptions() const {return buildOptions;}
+
+            #ifndef EZCL_NO_BINARY_CACHE
+                // programs are stored in and loaded from dir, an empty dir disables the binary cache
+                void setBinaryCacheDir(const std::string& dir) {binaryCacheDir = dir;}
+                const std::string& getBinaryCacheDir() const {return binaryCacheDir;}
+                // a copy, since other threads count builds under buildMutex
+                BinaryCacheStats getBinaryCacheStats() {
+                    std::lock_guard<std::mutex> building(buildMutex);
+                    return binaryCacheStats;
+                }
+            #endif
+
+            // the vector width used by the elementwise operations on type, must be 1, 2, 4, 8, or 16,
+            // defaults to the device's preferred width
+            void setVectorWidth(NumType type, cl_uint width) {
+                if (!validVectorWidth(width)) throw std::runtime_error("vector width must be 1, 2, 4, 8, or 16");
+                vectorWidths[type] = width;
+            }
+            cl_uint getVectorWidth(NumType type) const {return vectorWidths[type];}
+
+            // when enabled, the first launch of each elementwise kernel without a tuned local work size times
+            // the candidate sizes first, which also waits for everything already enqueued
+            void setAutotune(bool enabled) {
+                autotune = enabled;
+                tuningUsed = autotune || !localSizes.empty();
+            }
+            bool getAutotune() const {return autotune;}
+
+            // loads the local work sizes tuned for this device from path, and saves them there whenever a kernel is tuned,
+            // an empty path stops saving
+            void setTuningFile(const std::string& path) {
+                std::unique_lock<std::shared_mutex> lock(tuningMutex);
+                tuningFile = path;
+                if (!tuningFile.empty()) loadTuning();
+                tuningUsed = autotune || !localSizes.empty();
+            }
+            const std::string& getTuningFile() const {return tuningFile;}
+            const std::unordered_map<std::string, size_t>& getTuning() const {return localSizes;}
+
+            // blocks until every operation enqueued on this Device has completed
+            void finish() {
+                checkErr(clFinish(queue), "clFinish");
+                for (cl_command_queue q : extraQueues) checkErr(clFinish(q), "clFinish");
+                if (transferQueue) checkErr(clFinish(transferQueue), "clFinish");
+            }
+
+            // operations take turns on computeQueues in-order queues, and with transfer, reads and writes of Arrays
+            // get their own queue so they can overlap with kernels, with more than one queue the work on each Array
+            // is ordered by events, waits for everything enqueued so far
+            void setQueues(cl_uint computeQueues, bool transfer = false) {
+                if (computeQueues == 0) throw std::runtime_error("at least one compute queue required");
+
+                finish();
+                releaseQueues();
+                nextQueue = 0;
+
+                for (cl_uint i = 1; i < computeQueues; i++) extraQueues.push_back(createQueue());
+                if (transfer) transferQueue = createQueue();
+            }
+            cl_uint getComputeQueueCount() const {return static_cast<cl_uint>(extraQueues.size() + 1);}
+            bool hasTransferQueue() const {return transferQueue != nullptr;}
+            // the queue reads and writes of Arrays go to
+            cl_command_queue getTransferQueue() const {return copyQueue();}
+
+            // when enabled, the device times of every kernel and Array transfer are gathered per kernel key,
+            // transfers use the keys read, write, fill and map, the queues are recreated so no Array may be mapped
+            void setProfiling(bool enabled) {
+                if (enabled == profiling) return;
+
+                {
+                    std::lock_guard<std::mutex> lock(timingMutex);
+                    collectProfiles(true);
+                    profiling = enabled;
+                }
+                updateTimed();
+            }
+            bool getProfiling() const {return profiling;}
+
+            // waits for every profiled command, sorted by key
+            std::map<std::string, ProfileStats> getProfile() {
+                std::lock_guard<std::mutex> lock(timingMutex);
+                collectProfiles(true);
+
+                std::map<std::string, ProfileStats> profile;
+                std::vector<cl_ulong> samples[4];
+
+                for (const auto& kv : profileSamples) {
+                    for (std::vector<cl_ulong>& phase : samples) phase.clear();
+
+                    for (const std::array<cl_ulong, 4>& times : kv.second) {
+                        samples[0].push_back(times[1] - times[0]);
+                        samples[1].push_back(times[2] - times[1]);
+                        samples[2].push_back(times[3] - times[2]);
+                        samples[3].push_back(times[3] - times[0]);
+                    }
+
+                    ProfileStats& stats = profile[kv.first];
+                    stats.count = kv.second.size();
+                    stats.queued = makeProfileTiming(samples[0]);
+                    stats.submitted = makeProfileTiming(samples[1]);
+                    stats.running = makeProfileTiming(samples[2]);
+                    stats.overall = makeProfileTiming(samples[3]);
+                }
+
+                return profile;
+            }
+
+            // the profile as a JSON object of kernel keys, which never need escaping, times are in nanoseconds
+            std::string getProfileJson() {
+                std::ostringstream json;
+                json << "{";
+
+                bool first = true;
+                for (const auto& kv : getProfile()) {
+                    json << (first ? "\\n" : ",\\n") << "  \\"" << kv.first << "\\": {\\"count\\": " << kv.second.count;
+
+                    const std::pair<const char*, const ProfileTiming*> timings[] = {
+                        {"queued", &kv.second.queued}, {"submitted", &kv.second.submitted}, {"running", &kv.second.running}, {"overall", &kv.second.overall}
+                    };
+                    for (const auto& timing : timings) {
+                        json
+                            << ", \\"" << timing.first << "\\": {\\"total\\": " << timing.second->total << ", \\"min\\": " << timing.second->min
+                            << ", \\"max\\": " << timing.second->max << ", \\"p50\\": " << timing.second->p50 << ", \\"p99\\": " << timing.second->p99 << "}"
+                        ;
+                    }
+
+                    json << "}";
+                    first = false;
+                }
+
+                json << (first ? "}" : "\\n}");
+                return json.str();
             }
 
-            cl_kernel getKernel(const std::string& key, cl_program program) {
-                cl_int err;
+            void clearProfile() {
+                std::lock_guard<std::mutex> lock(timingMutex);
+                collectProfiles(true);
+                profileSamples.clear();
+            }
 
-                #ifndef EZCL_NO_CACHE
-                    auto it = kernelCache.find(key);
-                    if (it != kernelCache.end()) return it->second;
-                #endif
+            #ifndef EZCL_NO_TRACE
+                // when enabled, host spans for compiling, enqueueing and blocking reads are recorded, along with the device
+                // times of every command like with profiling, enabling discards what was recorded before
+                void setTracing(bool enabled) {
+                    if (enabled == tracing) return;
+
+                    std::unique_lock<std::mutex> lock(timingMutex);
+                    collectProfiles(true);
+                    tracing = enabled;
+                    if (tracing) {
+                        traceEvents.clear();
+                        traceStart = std::chrono::steady_clock::now();
+                    }
+                    lock.unlock();
+                    updateTimed();
+                }
+                bool getTracing() const {return tracing;}
+
+                // waits for every traced command, the result opens in Perfetto or chrome://tracing
+                std::string getTraceJson() {
+                    std::lock_guard<std::mutex> lock(timingMutex);
+                    collectProfiles(true);
+
+                    std::ostringstream json;
+                    json << std::fixed << std::setprecision(3) << "{\\"traceEvents\\": [";
+
+                    // names for the tracks
+                    const size_t tracks = extraQueues.size() + (transferQueue ? 3 : 2);
+                    for (size_t track = 0; track < tracks; track++) {
+                        std::string name = (track == 0) ? "host" : (transferQueue && track == tracks - 1) ? "transfer queue" : "queue " + std::to_string(track - 1);
+                        json
+                            << (track ? ",\\n" : "\\n") << "  {\\"name\\": \\"thread_name\\", \\"ph\\": \\"M\\", \\"pid\\": 1, \\"tid\\": " << track
+                            << ", \\"args\\": {\\"name\\": \\"" << name << "\\"}}"
+                        ;
+                    }
 
-                cl_kernel kernel = clCreateKernel(program, key.c_str(), &err);
-                checkErr(err, "clCreateKernel");
+                    // kernel keys never need escaping
+                    for (const TraceEvent& event : traceEvents) {
+                        json
+                            << ",\\n  {\\"name\\": \\"" << event.name << "\\", \\"cat\\": \\"" << event.category << "\\", \\"ph\\": \\"X\\", \\"pid\\": 1, \\"tid\\": " << event.track
+                            << ", \\"ts\\": " << event.start << ", \\"dur\\": " << event.duration
+                        ;
+                        if (event.track) json << ", \\"args\\": {\\"queued_us\\": " << event.queued << "}";
+                        json << "}";
+                    }
 
-                #ifndef EZCL_NO_CACHE
-                    kernelCache[key] = kernel;
-                #endif
+                    json << "\\n]}";
+                    return json.str();
+                }
+                void writeTrace(const std::string& path) {
+                    std::ofstream file(path);
+                    if (!file) throw std::runtime_error("cannot open trace file " + path);
+                    file << getTraceJson();
+                }
+                void clearTrace() {
+                    std::lock_guard<std::mutex> lock(timingMutex);
+                    collectProfiles(true);
+                    traceEvents.clear();
+                }
+            #endif
 
-                return kernel;
+            // most bytes of free buffers the pool keeps for reuse, 0 disables pooling for Arrays created afterwards
+            void setPoolLimit(size_t bytes) {
+                poolLimit = bytes;
+                trimPool(bytes);
+            }
+            size_t getPoolLimit() const {return poolLimit;}
+            // buffers larger than bytes are released instead of being pooled
+            void setPoolMaxBufferSize(size_t bytes) {poolMaxBuffer = bytes;}
+            size_t getPoolMaxBufferSize() const {return poolMaxBuffer;}
+            PoolStats getPoolStats() {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                return poolStats;
             }
 
-            void launchKernel(cl_kernel kernel, cl_mem& a, cl_mem& b, cl_mem& c, size_t size) {
-                cl_int err;
-                err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &a);
-                checkErr(err, "clSetKernelArg a");
-                err = clSetKernelArg(kernel, 1, sizeof(cl_mem), &b);
-                checkErr(err, "clSetKernelArg b");
-                err = clSetKernelArg(kernel, 2, sizeof(cl_mem), &c);
-                checkErr(err, "clSetKernelArg c");
-                err = clSetKernelArg(kernel, 3, sizeof(cl_ulong), &size);
-                checkErr(err, "clSetKernelArg s");
-
-                size_t global_work_size = size;
-                err = clEnqueueNDRangeKernel(queue, kernel, 1, nullptr, &global_work_size, nullptr, 0, nullptr, nullptr);
-                checkErr(err, "clEnqueueNDRangeKernel");
+            // releases free buffers, largest first, until the pool holds no more than keepBytes
+            void trimPool(size_t keepBytes = 0) {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                for (auto it = pool.rbegin(); it != pool.rend() && poolStats.bytesPooled > keepBytes; ++it) {
+                    std::vector<PooledBuffer>& buffers = it->second;
+
+                    while (!buffers.empty() && poolStats.bytesPooled > keepBytes) {
+                        clReleaseMemObject(buffers.back().mem);
+                        buffers.pop_back();
+                        poolStats.bytesPooled -= it->first.second;
+                        poolStats.buffersPooled--;
+                    }
+                }
             }
-            `;
-    source += `
-        public:
-            Device() : platform(nullptr), device(nullptr), context(nullptr), queue(nullptr) {}
-            Device(const Device&) = delete;
-            Device(cl_platform_id pf, cl_device_id dev) : platform(pf), device(dev) {
-                cl_int err; 
-                context = clCreateContext(nullptr, 1, &device, nullptr, nullptr, &err);
-                checkErr(err, "clCreateContext");
 
-                constexpr cl_queue_properties props[] = {0}; // no properties
-                queue = clCreateCommandQueueWithProperties(context, device, props, &err);
-                checkErr(err, "clCreateCommandQueueWithProperties");
+            // builds the kernels for every combination of types and ops as one program, so the first
+            // call of each operation doesn't have to invoke the compiler, does nothing with EZCL_NO_CACHE
+            void precompile(const std::vector<NumType>& types, const std::vector<OpType>& ops) {
+                #ifndef EZCL_NO_CACHE
+                    std::vector<std::string> keys;
+                    std::string src;
+
+                    std::lock_guard<std::mutex> building(buildMutex);
+
+                    for (OpType op : ops) {
+                        for (NumType type : types) {
+                            std::string key = kernelName(op, type, vectorWidths[type]);
+                            if (programCache.count(key)) continue;
+
+                            src += makeKernelFunction(key.c_str(), numInfo[type].clName, opInfo[op].op, vectorWidths[type]) + "\\n";
+                            keys.push_back(std::move(key));
+                        }
+                    }
+
+                    if (keys.empty()) return;
+
+                    std::string batch;
+                    for (const std::string& key : keys) batch += key + ";";
+
+                    std::ostringstream batchKey;
+                    batchKey << "precompiled-" << std::hex << stableHash(batch);
+                    cl_program program = buildProgram(src, batchKey.str());
+
+                    // every kernel's cache entry holds its own reference to the shared program,
+                    // the kernels are created on first use
+                    for (const std::string& key : keys) {
+                        clRetainProgram(program);
+                        programCache[key] = program;
+                    }
+                #else
+                    (void)types;
+                    (void)ops;
+                #endif
             }
-            Device(Device&& other) {
-                platform = other.platform;
-                device = other.device;
-                context = other.context;
-                queue = other.queue;
+            void precompile() {
+                std::vector<NumType> types;
+                std::vector<OpType> ops;
 
-                other.context = nullptr;
-                other.queue = nullptr;
+                for (size_t i = 0; i < std::size(numInfo); i++) types.push_back(static_cast<NumType>(i));
+                for (size_t i = 0; i < std::size(opInfo); i++) ops.push_back(static_cast<OpType>(i));
+
+                precompile(types, ops);
             }
-            
-            const cl_platform_id& getPlatform() {return platform;}
-            const cl_device_id& getDevice() {return device;}
-            const cl_context& getContext() {return context;}
-            const cl_command_queue& getQueue() {return queue;}
 
             Device& operator=(const Device&) = delete;
             Device& operator=(Device&& other) {
                 if (this != &other) {
+                    releasePool();
+                    releaseQueues();
                     if (queue) clReleaseCommandQueue(queue);
                     if (context) clReleaseContext(context);
 
@@ -374,9 +2641,56 @@ namespace ezcl {
                     device = other.device;
                     context = other.context;
                     queue = other.queue;
+                    extraQueues = std::move(other.extraQueues);
+                    transferQueue = other.transferQueue;
+                    nextQueue = other.nextQueue.load();
+                    profiling = other.profiling;
+                    timeCommands = other.timeCommands;
+                    pendingProfiles = std::move(other.pendingProfiles);
+                    collectAt = other.collectAt;
+                    profileSamples = std::move(other.profileSamples);
+
+                    #ifndef EZCL_NO_TRACE
+                        tracing = other.tracing;
+                        traceStart = other.traceStart;
+                        traceEvents = std::move(other.traceEvents);
+                    #endif
+
+                    computeUnits = other.computeUnits;
+                    maxWorkGroupSize = other.maxWorkGroupSize;
+                    std::copy(std::begin(other.vectorWidths), std::end(other.vectorWidths), vectorWidths);
+                    deviceTag = std::move(other.deviceTag);
+                    buildOptions = std::move(other.buildOptions);
+                    autotune = other.autotune;
+                    tuningUsed = other.tuningUsed.load();
+                    localSizes = std::move(other.localSizes);
+                    uncheckedSizes = std::move(other.uncheckedSizes);
+                    tuningFile = std::move(other.tuningFile);
+                    pool = std::move(other.pool);
+                    poolLimit = other.poolLimit;
+                    poolMaxBuffer = other.poolMaxBuffer;
+                    poolStats = other.poolStats;
+                    other.pool.clear();
+
+                    #ifndef EZCL_NO_CACHE
+                        kernelPools.clear();
+                        for (auto& kv : programCache) clReleaseProgram(kv.second);
+                        programCache = std::move(other.programCache);
+                        kernelPools = std::move(other.kernelPools);
+                        elementwiseKernels = std::move(other.elementwiseKernels);
+                        other.programCache.clear();
+                        other.kernelPools.clear();
+                    #endif
+
+                    #ifndef EZCL_NO_BINARY_CACHE
+                        binaryCacheDir = std::move(other.binaryCacheDir);
+                        binaryCacheStats = other.binaryCacheStats;
+                    #endif
 
                     other.context = nullptr;
                     other.queue = nullptr;
+                    other.extraQueues.clear();
+                    other.transferQueue = nullptr;
                 }
 
                 return *this;
@@ -384,53 +2698,334 @@ namespace ezcl {
 
     source += `
 
-            #pragma region // operations`;
+            #pragma region // operations
+
+                #pragma region // eval
+                    // evaluates an expression such as (a + b) * c with a single kernel and no intermediate Arrays
+                    template <typename E, std::enable_if_t<IsExpr<E>::value, int> = 0>
+                    void eval(Array<typename E::value_type>& c, const E& expr) {
+                        evalExpr(c, expr, {}, nullptr);
+                    }
+                    template <typename E, std::enable_if_t<IsExpr<E>::value, int> = 0>
+                    Event evalAsync(Array<typename E::value_type>& c, const E& expr, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        evalExpr(c, expr, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                #pragma endregion // eval
+`;
     
-    let _opType;
-    let _numType;
+    source += `
 
-    for (let i = 0; i < 4; i++) { // for each opType
-        _opType = opType[i];
-        source +=  "\n                #pragma region // " + opMeta[_opType].name;
+                #pragma region // apply
+                    // runs Op on every element, Op and T select the kernel at compile time,
+                    // so once built, finding it again is an array index
+                    template <OpType Op, typename T>
+                    void apply(Array<T>& a, Array<T>& b, Array<T>& c) {
+                        binaryOp(Op, NumTypeOf<T>::value, a, b, c, {}, nullptr);
+                    }
+                    template <OpType Op, typename T>
+                    Event applyAsync(Array<T>& a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        binaryOp(Op, NumTypeOf<T>::value, a, b, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <OpType Op, typename T>
+                    void apply(Array<T>& a, const Scalar<T> b, Array<T>& c) {
+                        scalarOp(Op, NumTypeOf<T>::value, a, b, false, c, {}, nullptr);
+                    }
+                    template <OpType Op, typename T>
+                    Event applyAsync(Array<T>& a, const Scalar<T> b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        scalarOp(Op, NumTypeOf<T>::value, a, b, false, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <OpType Op, typename T>
+                    void apply(const Scalar<T> a, Array<T>& b, Array<T>& c) {
+                        scalarOp(Op, NumTypeOf<T>::value, b, a, true, c, {}, nullptr);
+                    }
+                    template <OpType Op, typename T>
+                    Event applyAsync(const Scalar<T> a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        scalarOp(Op, NumTypeOf<T>::value, b, a, true, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                #pragma endregion // apply
+
+                #pragma region // math
+                    // calls the OpenCL built-in M on every element, functions without integer versions only take float and double
+                    template <MathType M, typename T>
+                    void apply(Array<T>& a, Array<T>& c) {
+                        checkMath<M, T, 1>();
+                        Array<T>* arrays[] = {&a};
+                        mathOp<T>(M, arrays, 1, nullptr, ARRAYS, c, {}, nullptr);
+                    }
+                    template <MathType M, typename T>
+                    Event applyAsync(Array<T>& a, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        checkMath<M, T, 1>();
+                        Array<T>* arrays[] = {&a};
+                        cl_event event;
+                        mathOp<T>(M, arrays, 1, nullptr, ARRAYS, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <MathType M, typename T>
+                    void apply(Array<T>& a, Array<T>& b, Array<T>& c) {
+                        checkMath<M, T, 2>();
+                        Array<T>* arrays[] = {&a, &b};
+                        mathOp<T>(M, arrays, 2, nullptr, ARRAYS, c, {}, nullptr);
+                    }
+                    template <MathType M, typename T>
+                    Event applyAsync(Array<T>& a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        checkMath<M, T, 2>();
+                        Array<T>* arrays[] = {&a, &b};
+                        cl_event event;
+                        mathOp<T>(M, arrays, 2, nullptr, ARRAYS, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <MathType M, typename T>
+                    void apply(Array<T>& a, const Scalar<T> b, Array<T>& c) {
+                        checkMath<M, T, 2>();
+                        Array<T>* arrays[] = {&a};
+                        mathOp<T>(M, arrays, 1, &b, ARRAY_SCALAR, c, {}, nullptr);
+                    }
+                    template <MathType M, typename T>
+                    Event applyAsync(Array<T>& a, const Scalar<T> b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        checkMath<M, T, 2>();
+                        Array<T>* arrays[] = {&a};
+                        cl_event event;
+                        mathOp<T>(M, arrays, 1, &b, ARRAY_SCALAR, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <MathType M, typename T>
+                    void apply(const Scalar<T> a, Array<T>& b, Array<T>& c) {
+                        checkMath<M, T, 2>();
+                        Array<T>* arrays[] = {&b};
+                        mathOp<T>(M, arrays, 1, &a, SCALAR_ARRAY, c, {}, nullptr);
+                    }
+                    template <MathType M, typename T>
+                    Event applyAsync(const Scalar<T> a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        checkMath<M, T, 2>();
+                        Array<T>* arrays[] = {&b};
+                        cl_event event;
+                        mathOp<T>(M, arrays, 1, &a, SCALAR_ARRAY, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <MathType M, typename T>
+                    void apply(Array<T>& a, Array<T>& b, Array<T>& d, Array<T>& c) {
+                        checkMath<M, T, 3>();
+                        Array<T>* arrays[] = {&a, &b, &d};
+                        mathOp<T>(M, arrays, 3, nullptr, ARRAYS, c, {}, nullptr);
+                    }
+                    template <MathType M, typename T>
+                    Event applyAsync(Array<T>& a, Array<T>& b, Array<T>& d, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        checkMath<M, T, 3>();
+                        Array<T>* arrays[] = {&a, &b, &d};
+                        cl_event event;
+                        mathOp<T>(M, arrays, 3, nullptr, ARRAYS, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <MathType M, typename T>
+                    void apply(Array<T>& a, const Scalar<T> b, const Scalar<T> d, Array<T>& c) {
+                        checkMath<M, T, 3>();
+                        Array<T>* arrays[] = {&a};
+                        const T scalars[] = {b, d};
+                        mathOp<T>(M, arrays, 1, scalars, ARRAY_SCALAR, c, {}, nullptr);
+                    }
+                    template <MathType M, typename T>
+                    Event applyAsync(Array<T>& a, const Scalar<T> b, const Scalar<T> d, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        checkMath<M, T, 3>();
+                        Array<T>* arrays[] = {&a};
+                        const T scalars[] = {b, d};
+                        cl_event event;
+                        mathOp<T>(M, arrays, 1, scalars, ARRAY_SCALAR, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                #pragma endregion // math
 
-        for (let j = 0; j < 11; j++) { // for each numType
-            _numType = numType[j];
-            if (_numType === "FLOAT16") continue; // unsupported
+                #pragma region // comparisons
+                    // writes 1 to mask where a Cmp b holds and 0 elsewhere
+                    template <CompareType Cmp, typename T>
+                    void apply(Array<T>& a, Array<T>& b, Array<unsigned char>& mask) {
+                        compareOp<T>(Cmp, a, &b, T(), mask, {}, nullptr);
+                    }
+                    template <CompareType Cmp, typename T>
+                    Event applyAsync(Array<T>& a, Array<T>& b, Array<unsigned char>& mask, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        compareOp<T>(Cmp, a, &b, T(), mask, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <CompareType Cmp, typename T>
+                    void apply(Array<T>& a, const Scalar<T> b, Array<unsigned char>& mask) {
+                        compareOp<T>(Cmp, a, nullptr, b, mask, {}, nullptr);
+                    }
+                    template <CompareType Cmp, typename T>
+                    Event applyAsync(Array<T>& a, const Scalar<T> b, Array<unsigned char>& mask, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        compareOp<T>(Cmp, a, nullptr, b, mask, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                #pragma endregion // comparisons
 
+                #pragma region // select
+                    // c is a where mask isn't 0 and b elsewhere
+                    template <typename T>
+                    void select(Array<unsigned char>& mask, Array<T>& a, Array<T>& b, Array<T>& c) {
+                        selectOp<T>(mask, &a, &b, T(), c, {}, nullptr);
+                    }
+                    template <typename T>
+                    Event selectAsync(Array<unsigned char>& mask, Array<T>& a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        selectOp<T>(mask, &a, &b, T(), c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <typename T>
+                    void select(Array<unsigned char>& mask, Array<T>& a, const Scalar<T> b, Array<T>& c) {
+                        selectOp<T>(mask, &a, nullptr, b, c, {}, nullptr);
+                    }
+                    template <typename T>
+                    Event selectAsync(Array<unsigned char>& mask, Array<T>& a, const Scalar<T> b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        selectOp<T>(mask, &a, nullptr, b, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                    template <typename T>
+                    void select(Array<unsigned char>& mask, const Scalar<T> a, Array<T>& b, Array<T>& c) {
+                        selectOp<T>(mask, nullptr, &b, a, c, {}, nullptr);
+                    }
+                    template <typename T>
+                    Event selectAsync(Array<unsigned char>& mask, const Scalar<T> a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {
+                        cl_event event;
+                        selectOp<T>(mask, nullptr, &b, a, c, waitList, &event);
+                        clFlush(queue);
+                        return Event(event);
+                    }
+                #pragma endregion // select
+`;
+
+    for (const _opType of opType) {
+        source += `
+                #pragma region // ${opMeta[_opType].name}
+                    template <typename T>
+                    void ${opMeta[_opType].name}(Array<T>& a, Array<T>& b, Array<T>& c) {apply<${opMeta[_opType].capsName}>(a, b, c);}
+                    template <typename T>
+                    Event ${opMeta[_opType].name}Async(Array<T>& a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${opMeta[_opType].capsName}>(a, b, c, waitList);}
+                    template <typename T>
+                    void ${opMeta[_opType].name}(Array<T>& a, const Scalar<T> b, Array<T>& c) {apply<${opMeta[_opType].capsName}>(a, b, c);}
+                    template <typename T>
+                    Event ${opMeta[_opType].name}Async(Array<T>& a, const Scalar<T> b, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${opMeta[_opType].capsName}>(a, b, c, waitList);}`;
+
+        if (!opMeta[_opType].commutative) {
             source += `
-                    void ${opMeta[_opType].name}(Array<${numMeta[_numType].numName}>& a, Array<${numMeta[_numType].numName}>& b, Array<${numMeta[_numType].numName}>& c) {
-                        if (!checkAccess(a, READ) || !checkAccess(b, READ) || !checkAccess(c, WRITE)) {
-                            throw std::runtime_error("invalid Array access permissions");
-                        }
+                    template <typename T>
+                    void ${opMeta[_opType].name}(const Scalar<T> a, Array<T>& b, Array<T>& c) {apply<${opMeta[_opType].capsName}>(a, b, c);}
+                    template <typename T>
+                    Event ${opMeta[_opType].name}Async(const Scalar<T> a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${opMeta[_opType].capsName}>(a, b, c, waitList);}`;
+        }
 
-                        if ((a.getSize() != c.getSize()) || (b.getSize() != c.getSize())) {
-                            throw std::runtime_error("all Arrays must be the same size");
-                        }
+        source += `
+                #pragma endregion // ${opMeta[_opType].name}
+`;
+    }
 
-                        const std::string kernelKey = "${opMeta[_opType].name}_${numMeta[_numType].className}";
-                        const std::string kernString = makeKernelFunction(kernelKey.c_str(), "${numMeta[_numType].numName}", '${opMeta[_opType].op}');
-                        
-                        cl_program program = buildProgram(kernString, kernelKey);
-                        cl_kernel kernel = getKernel(kernelKey, program);
-                        launchKernel(kernel, a.getMem(), b.getMem(), c.getMem(), c.getSize());
+    for (const _mathType of mathType) {
+        const meta = mathMeta[_mathType];
+        source += `
+                #pragma region // ${meta.name}`;
 
-                        #ifdef EZCL_NO_CACHE
-                            clReleaseKernel(kernel);
-                            clReleaseProgram(program);
-                        #endif
-                    }
-                `;
+        if (meta.operands === 1) {
+            source += `
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, Array<T>& c) {apply<${meta.capsName}>(a, c);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, c, waitList);}`;
+        } else if (meta.operands === 2) {
+            source += `
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, Array<T>& b, Array<T>& c) {apply<${meta.capsName}>(a, b, c);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, c, waitList);}
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, const Scalar<T> b, Array<T>& c) {apply<${meta.capsName}>(a, b, c);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, const Scalar<T> b, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, c, waitList);}`;
+
+            if (!meta.commutative) {
+                source += `
+                    template <typename T>
+                    void ${meta.name}(const Scalar<T> a, Array<T>& b, Array<T>& c) {apply<${meta.capsName}>(a, b, c);}
+                    template <typename T>
+                    Event ${meta.name}Async(const Scalar<T> a, Array<T>& b, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, c, waitList);}`;
+            }
+        } else {
+            source += `
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, Array<T>& b, Array<T>& d, Array<T>& c) {apply<${meta.capsName}>(a, b, d, c);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, Array<T>& b, Array<T>& d, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, d, c, waitList);}
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, const Scalar<T> b, const Scalar<T> d, Array<T>& c) {apply<${meta.capsName}>(a, b, d, c);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, const Scalar<T> b, const Scalar<T> d, Array<T>& c, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, d, c, waitList);}`;
         }
 
-        source += ""
-            + "                #pragma endregion // " + opMeta[_opType].name
-            + "\n"
-        ;
+        source += `
+                #pragma endregion // ${meta.name}
+`;
+    }
+
+    for (const _compareType of compareType) {
+        const meta = compareMeta[_compareType];
+        source += `
+                #pragma region // ${meta.name}
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, Array<T>& b, Array<unsigned char>& mask) {apply<${meta.capsName}>(a, b, mask);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, Array<T>& b, Array<unsigned char>& mask, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, mask, waitList);}
+                    template <typename T>
+                    void ${meta.name}(Array<T>& a, const Scalar<T> b, Array<unsigned char>& mask) {apply<${meta.capsName}>(a, b, mask);}
+                    template <typename T>
+                    Event ${meta.name}Async(Array<T>& a, const Scalar<T> b, Array<unsigned char>& mask, const std::vector<Event>& waitList = {}) {return applyAsync<${meta.capsName}>(a, b, mask, waitList);}
+                #pragma endregion // ${meta.name}
+`;
     }
 
-    source += `            #pragma endregion // operations
+    source += `
+                #pragma region // reductions`;
+
+    for (const _reduceType of reduceType) {
+        if (_reduceType === "DOT") {
+            source += `
+                    template <typename T>
+                    T dot(Array<T>& a, Array<T>& b) {return reduceArray(DOT, a, &b);}`;
+        } else {
+            source += `
+                    template <typename T>
+                    T ${reduceMeta[_reduceType].name}(Array<T>& a) {return reduceArray<T>(${reduceMeta[_reduceType].capsName}, a, nullptr);}`;
+        }
+    }
+    source += "\n";
+
+    source += `                #pragma endregion // reductions
+            #pragma endregion // operations
 
             ~Device() {
+                releasePool();
+                releaseQueues();
+
                 if (queue) {
                     clReleaseCommandQueue(queue);
                     queue = nullptr;
@@ -442,9 +3037,7 @@ namespace ezcl {
                 }
 
                 #ifndef EZCL_NO_CACHE
-                    for (auto& kv : kernelCache)
-                        clReleaseKernel(kv.second);
-                    kernelCache.clear();
+                    kernelPools.clear();
 
                     for (auto& kv : programCache)
                         clReleaseProgram(kv.second);
@@ -455,51 +3048,424 @@ namespace ezcl {
 
     // has to be defined after Device class definition
     template <typename T>
-    Array<T>::Array(Device& dev, AccessType acc, const std::vector<T>& dat) : device(dev), access(acc), size_(dat.size()) {
-        cl_int err;
-        data = clCreateBuffer(device.getContext(), access, sizeof(T) * dat.size(), (void*)dat.data(), &err);
-        checkErr(err, "clCreateBuffer");
-    }
+    Array<T>::Array(Device& dev, AccessType acc, const std::vector<T>& dat) : Array(dev, acc, dat.data(), dat.size()) {}
     
     template <typename T>
     template <size_t S>
-    Array<T>::Array(Device& dev, AccessType acc, const std::array<T, S>& dat) : device(dev), access(acc), size_(S) {
+    Array<T>::Array(Device& dev, AccessType acc, const std::array<T, S>& dat) : Array(dev, acc, dat.data(), S) {}
+    
+    // the buffer usually comes from the pool and is larger than the data, so the data is written instead of using CL_MEM_COPY_HOST_PTR
+    template <typename T>
+    Array<T>::Array(Device& dev, AccessType acc, const T* dat, const size_t s) : Array(dev, acc, s) {
+        write(dat, s);
+    }
+
+    template <typename T>
+    Array<T>::Array(Device& dev, AccessType acc, const size_t s) : device(dev), access(acc), size_(s), capacity(0), events(std::make_shared<ArrayEvents>()) {
+        Event ready;
+        data = device.acquireBuffer(access & ~CL_MEM_COPY_HOST_PTR, sizeof(T) * s, capacity, ready);
+        if (ready.valid()) tracked().written(ready);
+    }
+
+    template <typename T>
+    Array<T>::Array(Device& dev, AccessType acc, const size_t s, const T& value) : Array(dev, acc, s) {
+        std::vector<Event> deps;
+        cl_command_queue q = transferBefore(deps, true);
+
+        cl_int err;
+        cl_event event;
+        err = clEnqueueFillBuffer(q, data, &value, sizeof(T), 0, sizeof(T) * s, static_cast<cl_uint>(deps.size()), eventList(deps), &event);
+        checkErr(err, "clEnqueueFillBuffer");
+        transferAfter(event, true, "fill");
+    }
+
+    template <typename T>
+    Array<T>::Array(Device& dev, AccessType acc, const size_t s, HostMemory hm) : device(dev), access(acc), size_(s), capacity(0), events(std::make_shared<ArrayEvents>()) {
+        if (hm != ALLOC_HOST) throw std::runtime_error("USE_HOST Arrays need host memory to use");
+
         cl_int err;
-        data = clCreateBuffer(device.getContext(), access, sizeof(T) * S, (void*)dat.data(), &err);
+        data = clCreateBuffer(device.getContext(), (access & ~CL_MEM_COPY_HOST_PTR) | hm, sizeof(T) * s, nullptr, &err);
         checkErr(err, "clCreateBuffer");
     }
-    
+
     template <typename T>
-    Array<T>::Array(Device& dev, AccessType acc, const T* dat, const size_t s) : device(dev), access(acc), size_(s) {
+    Array<T>::Array(Device& dev, AccessType acc, T* dat, const size_t s, HostMemory hm) : device(dev), access(acc), size_(s), capacity(0), events(std::make_shared<ArrayEvents>()) {
+        // USE_HOST and COPY_HOST_PTR are mutually exclusive
+        const cl_mem_flags flags = (hm == USE_HOST) ? ((access & ~CL_MEM_COPY_HOST_PTR) | hm) : (static_cast<cl_mem_flags>(access) | hm);
+
         cl_int err;
-        data = clCreateBuffer(device.getContext(), access, sizeof(T) * s, (void*)dat, &err);
+        data = clCreateBuffer(device.getContext(), flags, sizeof(T) * s, dat, &err);
         checkErr(err, "clCreateBuffer");
     }
 
     template <typename T>
-    void Array<T>::read(std::vector<T>& v) {
+    Array<T>& Array<T>::operator=(Array&& other) {
+        if (this != &other) {
+            // device can't be rebound, and a buffer from another context must not end up in this Device's pool
+            if (&device != &other.device) throw std::runtime_error("cannot move an Array into an Array on another Device");
+
+            if (data) device.recycleBuffer(data, access & ~CL_MEM_COPY_HOST_PTR, capacity, events.get());
+
+            data = other.data;
+            access = other.access;
+            size_ = other.size_;
+            capacity = other.capacity;
+            events = other.events; // shared, so the moved-from Array still has events to track
+            other.data = nullptr;
+            other.size_ = 0;
+            other.capacity = 0;
+        }
+        
+        return *this;
+    }
+
+    template <typename T>
+    Array<T>::~Array() {
+        if (data) {
+            device.recycleBuffer(data, access & ~CL_MEM_COPY_HOST_PTR, capacity, events.get());
+            data = nullptr;
+        }
+    }
+
+    template <typename T>
+    Array<T> Array<T>::slice(const size_t offset, const size_t count) {
+        if (offset > size_ || count > size_ - offset) throw std::runtime_error("slice out of range");
+        if (count == 0) throw std::runtime_error("slice must not be empty");
+
+        // sub-buffers can't be nested, so slices of a slice are made from the buffer it is part of
+        cl_mem parent = nullptr;
+        size_t origin = 0;
+        clGetMemObjectInfo(data, CL_MEM_ASSOCIATED_MEMOBJECT, sizeof(parent), &parent, nullptr);
+        if (parent) clGetMemObjectInfo(data, CL_MEM_OFFSET, sizeof(origin), &origin, nullptr);
+        else parent = data;
+
+        const cl_buffer_region region = {origin + sizeof(T) * offset, sizeof(T) * count};
+        const size_t align = std::max<cl_uint>(DeviceId(device.getDevice()).memBaseAddrAlign() / 8, 1);
+        if (region.origin % align != 0) throw std::runtime_error("slice offset is not aligned to CL_DEVICE_MEM_BASE_ADDR_ALIGN");
+
         cl_int err;
-        v = std::vector<T>(size_);
-        err = clEnqueueReadBuffer(device.getQueue(), data, CL_TRUE, 0, sizeof(T) * size_, v.data(), 0, nullptr, nullptr);
-        checkErr(err, "clEnqueueReadBuffer");
+        cl_mem sub = clCreateSubBuffer(parent, 0, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+        checkErr(err, "clCreateSubBuffer");
+
+        // the slice keeps the buffer alive, so it is released instead of going back to the pool where another Array could get it
+        capacity = 0;
+
+        // work on a slice is ordered as if it was on the whole buffer
+        return Array(device, access, sub, count, events);
+    }
+
+    template <typename T>
+    cl_command_queue Array<T>::transferBefore(std::vector<Event>& deps, bool writing) {
+        if (events) {
+            if (writing) events->beforeWrite(deps);
+            else events->beforeRead(deps);
+        }
+
+        return device.copyQueue();
+    }
+
+    template <typename T>
+    Event Array<T>::transferAfter(cl_event event, bool writing, const char* key) {
+        Event e(event);
+        if (!e.valid()) return e;
+
+        if (device.timeCommands) device.profile(key, e);
+
+        if (device.tracking()) {
+            if (writing) tracked().written(e);
+            else tracked().read(e);
+            clFlush(device.copyQueue());
+        }
+
+        return e;
+    }
+
+    template <typename T>
+    Mapping<T> Array<T>::map(cl_map_flags flags) {
+        return map(0, size_, flags);
+    }
+
+    template <typename T>
+    Mapping<T> Array<T>::map(const size_t offset, const size_t count, cl_map_flags flags) {
+        if (offset + count > size_) throw std::runtime_error("mapped region out of range");
+
+        std::vector<Event> deps;
+        cl_command_queue q = transferBefore(deps, flags != CL_MAP_READ);
+
+        #ifndef EZCL_NO_TRACE
+            Device::HostSpan span(device, "read", "map");
+        #endif
+
+        cl_int err;
+        cl_event event = nullptr;
+        void* ptr = clEnqueueMapBuffer(q, data, CL_TRUE, flags, sizeof(T) * offset, sizeof(T) * count, static_cast<cl_uint>(deps.size()), eventList(deps), device.timeCommands ? &event : nullptr, &err);
+        checkErr(err, "clEnqueueMapBuffer");
+        if (event) device.profile("map", Event(event));
+        return Mapping<T>(q, data, static_cast<T*>(ptr), count, device.tracking() ? events : nullptr);
+    }
+
+    template <typename T>
+    void Array<T>::read(std::vector<T>& v) {
+        if (v.size() != size_) v.resize(size_);
+        read(v.data(), size_);
     }
     
     template <typename T>
     template <size_t S>
     void Array<T>::read(std::array<T, S>& a) {
         if (S != size_) throw std::runtime_error("read target array size mismatch");
+        read(a.data(), S);
+    }
+
+    template <typename T>
+    void Array<T>::read(T* dat, const size_t s, const size_t offset) {
+        if (offset > size_ || s > size_ - offset) throw std::runtime_error("read range out of bounds");
+        if (s == 0) return;
+        std::vector<Event> deps;
+        cl_command_queue q = transferBefore(deps, false);
+
+        #ifndef EZCL_NO_TRACE
+            Device::HostSpan span(device, "read", "read");
+        #endif
+
         cl_int err;
-        err = clEnqueueReadBuffer(device.getQueue(), data, CL_TRUE, 0, sizeof(T) * size_, a.data(), 0, nullptr, nullptr);
+        cl_event event = nullptr;
+        err = clEnqueueReadBuffer(q, data, CL_TRUE, sizeof(T) * offset, sizeof(T) * s, dat, static_cast<cl_uint>(deps.size()), eventList(deps), device.timeCommands ? &event : nullptr);
         checkErr(err, "clEnqueueReadBuffer");
+        if (event) device.profile("read", Event(event));
+    }
+
+    #ifdef __cpp_lib_span
+        template <typename T>
+        void Array<T>::read(std::span<T> sp, const size_t offset) {
+            read(sp.data(), sp.size(), offset);
+        }
+    #endif
+
+    template <typename T>
+    Event Array<T>::readAsync(std::vector<T>& v, const std::vector<Event>& waitList) {
+        if (v.size() != size_) v.resize(size_);
+        return readAsync(v.data(), size_, 0, waitList);
+    }
+
+    template <typename T>
+    template <size_t S>
+    Event Array<T>::readAsync(std::array<T, S>& a, const std::vector<Event>& waitList) {
+        if (S != size_) throw std::runtime_error("read target array size mismatch");
+        return readAsync(a.data(), S, 0, waitList);
+    }
+
+    template <typename T>
+    Event Array<T>::readAsync(T* dat, const size_t s, const std::vector<Event>& waitList) {
+        return readAsync(dat, s, 0, waitList);
     }
 
     template <typename T>
-    void Array<T>::read(T* dat, const size_t s) {
-        if (s != size_) throw std::runtime_error("read target array size mismatch");
+    Event Array<T>::readAsync(T* dat, const size_t s, const size_t offset, const std::vector<Event>& waitList) {
+        if (offset > size_ || s > size_ - offset) throw std::runtime_error("read range out of bounds");
+        std::vector<Event> deps = waitList;
+        cl_command_queue q = transferBefore(deps, false);
+
         cl_int err;
-        err = clEnqueueReadBuffer(device.getQueue(), data, CL_TRUE, 0, sizeof(T) * size_, dat, 0, nullptr, nullptr);
+        cl_event event;
+        err = clEnqueueReadBuffer(q, data, CL_FALSE, sizeof(T) * offset, sizeof(T) * s, dat, static_cast<cl_uint>(deps.size()), eventList(deps), &event);
         checkErr(err, "clEnqueueReadBuffer");
+        clFlush(q);
+        return transferAfter(event, false, "read");
+    }
+
+    #ifdef __cpp_lib_span
+        template <typename T>
+        Event Array<T>::readAsync(std::span<T> sp, const size_t offset, const std::vector<Event>& waitList) {
+            return readAsync(sp.data(), sp.size(), offset, waitList);
+        }
+    #endif
+
+    template <typename T>
+    void Array<T>::write(const std::vector<T>& v, const size_t offset) {
+        write(v.data(), v.size(), offset);
+    }
+
+    template <typename T>
+    template <size_t S>
+    void Array<T>::write(const std::array<T, S>& a, const size_t offset) {
+        write(a.data(), S, offset);
+    }
+
+    template <typename T>
+    void Array<T>::write(const T* dat, const size_t s, const size_t offset) {
+        if (offset > size_ || s > size_ - offset) throw std::runtime_error("write source out of range");
+        if (s == 0) return;
+        std::vector<Event> deps;
+        cl_command_queue q = transferBefore(deps, true);
+
+        cl_int err;
+        cl_event event = nullptr;
+        err = clEnqueueWriteBuffer(q, data, CL_TRUE, sizeof(T) * offset, sizeof(T) * s, dat, static_cast<cl_uint>(deps.size()), eventList(deps), device.timeCommands ? &event : nullptr);
+        checkErr(err, "clEnqueueWriteBuffer");
+        if (event) device.profile("write", Event(event));
+
+        // nothing enqueued on the Array before is outstanding anymore
+        if (events) events->written(Event());
+    }
+
+    template <typename T>
+    Event Array<T>::writeAsync(const std::vector<T>& v, const std::vector<Event>& waitList) {
+        return writeAsync(v.data(), v.size(), 0, waitList);
+    }
+
+    template <typename T>
+    template <size_t S>
+    Event Array<T>::writeAsync(const std::array<T, S>& a, const std::vector<Event>& waitList) {
+        return writeAsync(a.data(), S, 0, waitList);
+    }
+
+    template <typename T>
+    Event Array<T>::writeAsync(const T* dat, const size_t s, const size_t offset, const std::vector<Event>& waitList) {
+        if (offset > size_ || s > size_ - offset) throw std::runtime_error("write source out of range");
+        std::vector<Event> deps = waitList;
+        cl_command_queue q = transferBefore(deps, true);
+
+        cl_int err;
+        cl_event event;
+        err = clEnqueueWriteBuffer(q, data, CL_FALSE, sizeof(T) * offset, sizeof(T) * s, dat, static_cast<cl_uint>(deps.size()), eventList(deps), &event);
+        checkErr(err, "clEnqueueWriteBuffer");
+        clFlush(q);
+        return transferAfter(event, true, "write");
+    }
+
+    // several Devices sharing the elementwise operations on host data, each getting a shard
+    // proportional to its measured throughput, all running concurrently from their own thread
+    class DeviceGroup {
+        private:
+            std::vector<std::unique_ptr<Device>> devices; // Arrays hold references, so Devices never move
+            std::vector<double> weights; // elements per second, or a guess until measured
+
+            // shard boundaries, devices[i] covers [bounds[i], bounds[i + 1])
+            std::vector<size_t> split(size_t s) const {
+                double total = 0.0;
+                for (double w : weights) total += w;
+
+                std::vector<size_t> bounds(devices.size() + 1, 0);
+                double acc = 0.0;
+                for (size_t i = 0; i < devices.size(); i++) {
+                    acc += weights[i];
+                    bounds[i + 1] = (i + 1 == devices.size()) ? s : static_cast<size_t>(s * (acc / total));
+                }
+
+                return bounds;
+            }
+
+            // runs Op on every non-empty shard at once, then refines the weights with the measured throughput
+            template <OpType Op, typename T>
+            void run(const T* a, const T* b, T* c, size_t s) {
+                if (devices.empty()) throw std::runtime_error("DeviceGroup has no devices");
+
+                const std::vector<size_t> bounds = split(s);
+                std::vector<double> seconds(devices.size(), 0.0);
+                std::vector<std::exception_ptr> errors(devices.size());
+
+                auto shard = [&](size_t i) {
+                    const size_t offset = bounds[i];
+                    const size_t count = bounds[i + 1] - bounds[i];
+                    if (count == 0) return;
+
+                    try {
+                        const auto start = std::chrono::steady_clock::now();
+
+                        Device& dev = *devices[i];
+                        Array<T> arrA(dev, READ_ONLY, a + offset, count);
+                        Array<T> arrB(dev, READ_ONLY, b + offset, count);
+                        Array<T> arrC(dev, WRITE_ONLY, count);
+
+                        dev.apply<Op>(arrA, arrB, arrC);
+
+                        arrC.read(c + offset, count);
+
+                        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                        seconds[i] = elapsed.count();
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                };
+
+                std::vector<std::thread> threads;
+                for (size_t i = 1; i < devices.size(); i++) threads.emplace_back(shard, i);
+                shard(0);
+                for (std::thread& thread : threads) thread.join();
+
+                for (std::exception_ptr& error : errors)
+                    if (error) std::rethrow_exception(error);
+
+                // small shards are dominated by fixed costs, so they don't say much about throughput
+                for (size_t i = 0; i < devices.size(); i++) {
+                    const size_t count = bounds[i + 1] - bounds[i];
+                    if (count >= 65536 && seconds[i] > 0.0) weights[i] = 0.5 * weights[i] + 0.5 * (count / seconds[i]);
+                }
+            }
+
+        public:
+            // every device of every platform
+            DeviceGroup() {
+                for (const PlatformId& platform : getPlatforms())
+                    for (const DeviceId& device : platform.getDevices()) addDevice(platform, device);
+            }
+            DeviceGroup(const DeviceGroup&) = delete;
+            DeviceGroup(DeviceGroup&&) = default;
+
+            // until measured, a device is assumed to be as fast as its compute units
+            void addDevice(cl_platform_id pf, cl_device_id dev) {
+                devices.push_back(std::make_unique<Device>(pf, dev));
+                weights.push_back(std::max<cl_uint>(DeviceId(dev).computeUnits(), 1));
+            }
+
+            size_t size() const {return devices.size();}
+            Device& operator[](size_t i) {return *devices[i];}
+
+            // relative share of the work given to each device
+            const std::vector<double>& getWeights() const {return weights;}
+            void setWeights(const std::vector<double>& w) {
+                if (w.size() != devices.size()) throw std::runtime_error("one weight per device required");
+                for (double x : w) if (!(x > 0.0)) throw std::runtime_error("weights must be positive");
+                weights = w;
+            }
+
+            // measures each device alone adding s floats, including the transfers, and weights it by the result
+            void calibrate(size_t s = 1 << 22) {
+                const std::vector<float> host(s, 1.0f);
+                std::vector<float> result(s);
+
+                for (size_t i = 0; i < devices.size(); i++) {
+                    Device& dev = *devices[i];
+                    Array<float> a(dev, READ_ONLY, host);
+                    Array<float> c(dev, WRITE_ONLY, s);
+                    dev.add(a, a, c); // builds the kernel
+
+                    const auto start = std::chrono::steady_clock::now();
+                    Array<float> b(dev, READ_ONLY, host);
+                    dev.add(a, b, c);
+                    c.read(result.data(), s);
+                    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                    weights[i] = s / std::max(elapsed.count(), 1e-9);
+                }
+            }
+`;
+    for (const _opType of opType) {
+        source += `
+            template <typename T>
+            void ${opMeta[_opType].name}(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& c) {
+                if (a.size() != b.size()) throw std::runtime_error("array size mismatch");
+                if (c.size() != a.size()) c.resize(a.size());
+                run<${opMeta[_opType].capsName}>(a.data(), b.data(), c.data(), a.size());
+            }
+            template <typename T>
+            void ${opMeta[_opType].name}(const T* a, const T* b, T* c, const size_t s) {
+                run<${opMeta[_opType].capsName}>(a, b, c, s);
+            }
+`;
     }
+    source += `    }; // class DeviceGroup
 } // namespace ezcl`;
 
     fs.writeFile(sourcePath, source, (err) => {
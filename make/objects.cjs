@@ -1,25 +1,70 @@
+// maskName is the signed integer type of the same size, which vector comparisons return and select takes
 const numMeta = {
-    INT8: {className: "int8", numName: "char"},
-    INT16: {className: "int16", numName: "short"},
-    INT32: {className: "int32", numName: "int"},
-    INT64: {className: "int64", numName: "long long int"},
-    UINT8: {className: "uint8", numName: "unsigned char"},
-    UINT16: {className: "uint16", numName: "unsigned short"},
-    UINT32: {className: "uint32", numName: "unsigned int"},
-    UINT64: {className: "uint64", numName: "unsigned long long int"},
-    FLOAT16: {className: "float16", numName: "not yet implemented"},
-    FLOAT32: {className: "float32", numName: "float"},
-    FLOAT64: {className: "float64", numName: "double"},
+    INT8: {className: "int8", numName: "char", clName: "char", minName: "CHAR_MIN", maxName: "CHAR_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR", maskName: "char"},
+    INT16: {className: "int16", numName: "short", clName: "short", minName: "SHRT_MIN", maxName: "SHRT_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT", maskName: "short"},
+    INT32: {className: "int32", numName: "int", clName: "int", minName: "INT_MIN", maxName: "INT_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT", maskName: "int"},
+    INT64: {className: "int64", numName: "long long int", clName: "long", minName: "LONG_MIN", maxName: "LONG_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG", maskName: "long"},
+    UINT8: {className: "uint8", numName: "unsigned char", clName: "uchar", minName: "0", maxName: "UCHAR_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR", maskName: "char"},
+    UINT16: {className: "uint16", numName: "unsigned short", clName: "ushort", minName: "0", maxName: "USHRT_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT", maskName: "short"},
+    UINT32: {className: "uint32", numName: "unsigned int", clName: "uint", minName: "0", maxName: "UINT_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT", maskName: "int"},
+    UINT64: {className: "uint64", numName: "unsigned long long int", clName: "ulong", minName: "0", maxName: "ULONG_MAX", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG", maskName: "long"},
+    FLOAT16: {className: "float16", numName: "not yet implemented", clName: "half", minName: "-INFINITY", maxName: "INFINITY", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF", maskName: "short"},
+    FLOAT32: {className: "float32", numName: "float", clName: "float", minName: "-INFINITY", maxName: "INFINITY", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT", maskName: "int"},
+    FLOAT64: {className: "float64", numName: "double", clName: "double", minName: "-INFINITY", maxName: "INFINITY", vectorWidthInfo: "CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE", maskName: "long"},
 };
 
 const opMeta = {
-    ADD: {name: "add", capsName: "ADD", op: "+"},
-    SUB: {name: "sub", capsName: "SUB", op: "-"},
-    MUL: {name: "mul", capsName: "MUL", op: "*"},
-    DIV: {name: "div", capsName: "DIV", op: "/"},
+    ADD: {name: "add", capsName: "ADD", op: "+", commutative: true},
+    SUB: {name: "sub", capsName: "SUB", op: "-", commutative: false},
+    MUL: {name: "mul", capsName: "MUL", op: "*", commutative: true},
+    DIV: {name: "div", capsName: "DIV", op: "/", commutative: false},
+};
+
+// OpenCL built-ins, or operators if isOperator, a function is null for the types it doesn't take,
+// MINIMUM and MAXIMUM keep the reductions' MIN and MAX free, the bitwise names avoid the C++ keywords and, or, xor and not
+const mathMeta = {
+    SQRT: {name: "sqrt", capsName: "SQRT", floatFunction: "sqrt", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    RSQRT: {name: "rsqrt", capsName: "RSQRT", floatFunction: "rsqrt", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    EXP: {name: "exp", capsName: "EXP", floatFunction: "exp", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    LOG: {name: "log", capsName: "LOG", floatFunction: "log", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    ABS: {name: "abs", capsName: "ABS", floatFunction: "fabs", intFunction: "abs", operands: 1, commutative: false, isOperator: false},
+    SIN: {name: "sin", capsName: "SIN", floatFunction: "sin", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    COS: {name: "cos", capsName: "COS", floatFunction: "cos", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    TANH: {name: "tanh", capsName: "TANH", floatFunction: "tanh", intFunction: null, operands: 1, commutative: false, isOperator: false},
+    POW: {name: "pow", capsName: "POW", floatFunction: "pow", intFunction: null, operands: 2, commutative: false, isOperator: false},
+    MINIMUM: {name: "min", capsName: "MINIMUM", floatFunction: "fmin", intFunction: "min", operands: 2, commutative: true, isOperator: false},
+    MAXIMUM: {name: "max", capsName: "MAXIMUM", floatFunction: "fmax", intFunction: "max", operands: 2, commutative: true, isOperator: false},
+    FMA: {name: "fma", capsName: "FMA", floatFunction: "fma", intFunction: null, operands: 3, commutative: false, isOperator: false},
+    CLAMP: {name: "clamp", capsName: "CLAMP", floatFunction: "clamp", intFunction: "clamp", operands: 3, commutative: false, isOperator: false},
+    AND: {name: "bitAnd", capsName: "AND", floatFunction: null, intFunction: "&", operands: 2, commutative: true, isOperator: true},
+    OR: {name: "bitOr", capsName: "OR", floatFunction: null, intFunction: "|", operands: 2, commutative: true, isOperator: true},
+    XOR: {name: "bitXor", capsName: "XOR", floatFunction: null, intFunction: "^", operands: 2, commutative: true, isOperator: true},
+    NOT: {name: "bitNot", capsName: "NOT", floatFunction: null, intFunction: "~", operands: 1, commutative: false, isOperator: true},
+    SHL: {name: "shl", capsName: "SHL", floatFunction: null, intFunction: "<<", operands: 2, commutative: false, isOperator: true},
+    SHR: {name: "shr", capsName: "SHR", floatFunction: null, intFunction: ">>", operands: 2, commutative: false, isOperator: true},
+};
+
+// write an Array<unsigned char> mask of 1 where the comparison holds and 0 elsewhere
+const compareMeta = {
+    LESS: {name: "less", capsName: "LESS", op: "<"},
+    LESS_EQUAL: {name: "lessEqual", capsName: "LESS_EQUAL", op: "<="},
+    GREATER: {name: "greater", capsName: "GREATER", op: ">"},
+    GREATER_EQUAL: {name: "greaterEqual", capsName: "GREATER_EQUAL", op: ">="},
+    EQUAL: {name: "equal", capsName: "EQUAL", op: "=="},
+    NOT_EQUAL: {name: "notEqual", capsName: "NOT_EQUAL", op: "!="},
+};
+
+const reduceMeta = {
+    SUM: {name: "sum", capsName: "SUM"},
+    MIN: {name: "min", capsName: "MIN"},
+    MAX: {name: "max", capsName: "MAX"},
+    DOT: {name: "dot", capsName: "DOT"},
 };
 
 module.exports = {
     numMeta,
     opMeta,
+    mathMeta,
+    compareMeta,
+    reduceMeta,
 };
\ No newline at end of file
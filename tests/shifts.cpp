@@ -0,0 +1,91 @@
+#include <iostream>
+#include <vector>
+#include <type_traits>
+
+#include "../bench/common.hpp"
+
+// checks shl and shr against the host for counts past the bits of the type, at every vector width,
+// on a size that isn't a multiple of any width so the elements at the end run the scalar path,
+// exits with 1 on any mismatch
+
+bool passed = true;
+
+template <typename T>
+T hostShift(T a, T count, bool left) {
+    using U = std::make_unsigned_t<T>;
+    const unsigned n = static_cast<unsigned>(static_cast<U>(count) & (sizeof(T) * 8 - 1));
+
+    // shifting the unsigned type avoids undefined behaviour for negative values shifted left
+    if (left) return static_cast<T>(static_cast<U>(a) << n);
+    return static_cast<T>(a >> n);
+}
+
+template <typename T>
+void check(ezcl::Device& dev, ezcl::NumType type) {
+    const size_t s = 1003;
+    const cl_uint preferred = dev.getVectorWidth(type);
+
+    std::vector<T> values(s), counts(s);
+    for (size_t i = 0; i < s; i++) {
+        values[i] = static_cast<T>(i * 37 + 11);
+        counts[i] = static_cast<T>(i % (sizeof(T) * 16 + 3)); // up to twice the bits of T and a few more
+    }
+
+    ezcl::Array<T> a(dev, ezcl::READ_ONLY, values);
+    ezcl::Array<T> b(dev, ezcl::READ_ONLY, counts);
+    ezcl::Array<T> c(dev, ezcl::READ_WRITE, s);
+    std::vector<T> result(s);
+
+    for (cl_uint width = 1; width <= 16; width *= 2) {
+        dev.setVectorWidth(type, width);
+
+        for (int form = 0; form < 4; form++) {
+            const bool left = form % 2 == 0;
+            const T scalarCount = static_cast<T>(sizeof(T) * 8 + 3);
+
+            if (form < 2) {
+                if (left) dev.shl(a, b, c);
+                else dev.shr(a, b, c);
+            } else {
+                if (left) dev.shl(a, scalarCount, c);
+                else dev.shr(a, scalarCount, c);
+            }
+            c.read(result);
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < s; i++) {
+                const T expected = hostShift(values[i], (form < 2) ? counts[i] : scalarCount, left);
+                if (result[i] != expected) mismatches++;
+            }
+
+            if (mismatches) {
+                passed = false;
+                std::cout
+                    << ezcl::numInfo[type].className << " width " << width << ' ' << (left ? "shl" : "shr")
+                    << ((form < 2) ? " by Array: " : " by scalar: ") << mismatches << " mismatches\n"
+                ;
+            }
+        }
+    }
+
+    dev.setVectorWidth(type, preferred);
+}
+
+int main() {
+    const auto [platform, device] = pickDevice();
+    ezcl::Device dev(platform, device);
+
+    std::cout << "Device: " << device.name() << " (" << device.typeString() << ")\n";
+
+    check<char>(dev, ezcl::INT8);
+    check<short>(dev, ezcl::INT16);
+    check<int>(dev, ezcl::INT32);
+    check<long long int>(dev, ezcl::INT64);
+    check<unsigned char>(dev, ezcl::UINT8);
+    check<unsigned short>(dev, ezcl::UINT16);
+    check<unsigned int>(dev, ezcl::UINT32);
+    check<unsigned long long int>(dev, ezcl::UINT64);
+
+    std::cout << (passed ? "shifts match the host" : "shifts don't match the host") << '\n';
+    return passed ? 0 : 1;
+}